@@ -0,0 +1,278 @@
+// Runs many independent races at once, one GameModel each, on a work
+// stealing pool, then reports the completion times and writes the
+// statistics of every session.
+//      --sessions <n>      races to run (default 1000)
+//      --threads <n>       workers, 0 for one per hardware thread (default)
+//      --max-time <s>      game time after which a race is abandoned (default 300)
+//      --tick-rate <n>     simulation steps per second (default 120)
+//      --script <file>     every session plays this input (see input_script.hpp)
+//                          instead of the autopilot
+//      --csv <file>        statistics of each session
+//      --seed <n> --asteroids <n> --crystals <n> --checkpoints <n>
+//                          procedural field instead of the hand made race
+//      --fields <n>        procedural fields used, session i races on seed + i % n
+// Without a script each session is flown by an autopilot with its own
+// steering parameters, derived from the session index.
+// Run with `make batch ARGS="--sessions 10000 --csv races.csv"`
+#include "game_model.hpp"
+#include "input_script.hpp"
+#include "log.h"
+#include <work_stealing_pool.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <glm/gtc/quaternion.hpp>
+
+// Flies straight to the next checkpoint, boosting when it points at it
+struct Autopilot {
+    float gain;         // steering strength
+    float boostAlign;   // cosine of the largest angle to the target which still boosts
+    float boostRange;   // no boost closer than this to the target
+
+    // parameters spread over the sessions, the same for the same index
+    Autopilot(uint32_t session) {
+        // splitmix64
+        uint64_t z = session + 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        z ^= z >> 31;
+        gain = 1.0f + 7.0f * (z & 0xffff) / 65535.0f;
+        boostAlign = 0.9f + 0.099f * ((z >> 16) & 0xffff) / 65535.0f;
+        boostRange = 10.0f + 50.0f * ((z >> 32) & 0xffff) / 65535.0f;
+    }
+
+    ControlInput input(const GameModel &game) const {
+        const Checkpoint &target = game.checkpoints[game.stats.checkpoints % game.checkpoints.size()];
+        glm::vec3 toTarget = target.position - game.character.position;
+        float distance = glm::length(toTarget);
+        // direction of the target in the frame of the ship, forward is -z
+        glm::vec3 d = glm::inverse(game.character.rotation) * (toTarget / std::max(distance, 1e-4f));
+
+        ControlInput in;
+        in.m.z = 1.0f;
+        if(d.z > 0.0f) {
+            // behind: turn as fast as possible
+            in.r.y = d.x >= 0.0f ? 1.0f : -1.0f;
+            in.r.x = d.y >= 0.0f ? -1.0f : 1.0f;
+        } else {
+            in.r.y = glm::clamp(gain * d.x, -1.0f, 1.0f);
+            in.r.x = glm::clamp(-gain * d.y, -1.0f, 1.0f);
+        }
+        in.fire = game.boost && -d.z > boostAlign && distance > boostRange;
+        return in;
+    }
+};
+
+struct Options {
+    int sessions = 1000;
+    size_t threads = 0;
+    float maxTime = 300.0f;
+    float tickRate = 120.0f;
+    std::string script;
+    std::string csv;
+    bool proceduralField = false;
+    int fields = 1;
+    FieldParams field;
+};
+
+struct SessionResult {
+    uint32_t seed;
+    bool finished;
+    RaceStats stats;
+    unsigned long ticks;
+    uint64_t hash;
+    double seconds;     // wall time
+};
+
+static bool parseArgs(int argc, char **argv, Options &options) {
+    for(int i = 1; i < argc; i++) {
+        if(i + 1 >= argc) {
+            logError("Missing value for %s", argv[i]);
+            return false;
+        }
+        try {
+            if(!strcmp(argv[i], "--sessions")) {
+                options.sessions = std::stoi(argv[++i]);
+                if(options.sessions <= 0) {
+                    throw std::invalid_argument("sessions");
+                }
+            } else if(!strcmp(argv[i], "--threads")) {
+                options.threads = std::stoul(argv[++i]);
+            } else if(!strcmp(argv[i], "--max-time")) {
+                options.maxTime = std::stof(argv[++i]);
+            } else if(!strcmp(argv[i], "--tick-rate")) {
+                options.tickRate = std::stof(argv[++i]);
+                if(options.tickRate <= 0.0f) {
+                    throw std::invalid_argument("tick rate");
+                }
+            } else if(!strcmp(argv[i], "--script")) {
+                options.script = argv[++i];
+            } else if(!strcmp(argv[i], "--csv")) {
+                options.csv = argv[++i];
+            } else if(!strcmp(argv[i], "--seed")) {
+                options.field.seed = std::stoul(argv[++i]);
+                options.proceduralField = true;
+            } else if(!strcmp(argv[i], "--asteroids")) {
+                options.field.asteroids = std::stoi(argv[++i]);
+                options.proceduralField = true;
+            } else if(!strcmp(argv[i], "--crystals")) {
+                options.field.powerUps = std::stoi(argv[++i]);
+                options.proceduralField = true;
+            } else if(!strcmp(argv[i], "--checkpoints")) {
+                options.field.checkpoints = std::stoi(argv[++i]);
+                options.proceduralField = true;
+            } else if(!strcmp(argv[i], "--fields")) {
+                options.fields = std::stoi(argv[++i]);
+                if(options.fields <= 0) {
+                    throw std::invalid_argument("fields");
+                }
+                options.proceduralField = true;
+            } else {
+                logError("Unknown option %s", argv[i]);
+                return false;
+            }
+        } catch (const std::exception& e) {
+            logError("Invalid value for %s", argv[i - 1]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static SessionResult runSession(int session, const Options &options, const InputScript &script,
+                                const std::vector<GameModel> &fields) {
+    auto start = std::chrono::steady_clock::now();
+    SessionResult result;
+
+    int field = session % fields.size();
+    result.seed = options.proceduralField ? options.field.seed + field : 0;
+    // a copy of the field before the start, its grids included
+    GameModel game = fields[field];
+
+    const float deltaT = 1.0f / options.tickRate;
+    Autopilot pilot(session);
+    ScriptPlayer player(script);
+    while(game.stats.laps == 0 && game.time < options.maxTime) {
+        if(options.script.empty()) {
+            game.step(deltaT, pilot.input(game));
+        } else {
+            game.step(deltaT, player.next());
+        }
+    }
+
+    result.finished = game.stats.laps > 0;
+    result.stats = game.stats;
+    result.ticks = game.ticks;
+    result.hash = game.hash();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+static void writeCsv(const std::string &file, const std::vector<SessionResult> &results) {
+    FILE *out = fopen(file.c_str(), "w");
+    if(!out) {
+        throw std::runtime_error("Unable to create " + file);
+    }
+    fprintf(out, "session,seed,finished,lap_time,checkpoints,bounces,power_ups,ticks,hash,wall_ms\n");
+    for(size_t i = 0; i < results.size(); i++) {
+        const SessionResult &r = results[i];
+        fprintf(out, "%zu,%u,%d,%.3f,%d,%d,%d,%lu,%016" PRIx64 ",%.3f\n",
+            i, r.seed, r.finished, r.finished ? r.stats.lapTime : 0.0f,
+            r.stats.checkpoints, r.stats.bounces, r.stats.powerUps,
+            r.ticks, r.hash, r.seconds * 1000.0);
+    }
+    fclose(out);
+}
+
+// value below which the given fraction of the sorted values falls
+static float percentile(const std::vector<float> &sorted, float fraction) {
+    return sorted[std::min(sorted.size() - 1, (size_t)(fraction * sorted.size()))];
+}
+
+int main(int argc, char **argv) {
+    // the sessions would flood the output with their debug messages
+    logSetLevel(LOG_LEVEL_WARNING);
+
+    Options options;
+    if(!parseArgs(argc, argv, options)) {
+        return EXIT_FAILURE;
+    }
+
+    try {
+        InputScript script;
+        if(!options.script.empty()) {
+            script.load(options.script);
+        }
+
+        // each field is generated once, the sessions race on copies
+        std::vector<GameModel> fields;
+        fields.reserve(options.fields);
+        if(options.proceduralField) {
+            for(int i = 0; i < options.fields; i++) {
+                FieldParams params = options.field;
+                params.seed += i;
+                fields.emplace_back(params);
+            }
+        } else {
+            fields.emplace_back();
+        }
+
+        std::vector<SessionResult> results(options.sessions);
+        WorkStealingPool pool(options.threads);
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < options.sessions; i++) {
+            pool.submit([&, i]{
+                results[i] = runSession(i, options, script, fields);
+            });
+        }
+        pool.wait();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        unsigned long ticks = 0;
+        std::vector<float> lapTimes;
+        long checkpoints = 0, bounces = 0, powerUps = 0;
+        for(const SessionResult &r : results) {
+            ticks += r.ticks;
+            checkpoints += r.stats.checkpoints;
+            bounces += r.stats.bounces;
+            powerUps += r.stats.powerUps;
+            if(r.finished) {
+                lapTimes.push_back(r.stats.lapTime);
+            }
+        }
+        std::sort(lapTimes.begin(), lapTimes.end());
+
+        printf("Sessions:    %d on %zu threads (%zu tasks stolen)\n",
+            options.sessions, pool.size(), pool.steals());
+        printf("Wall time:   %.3f s, %.0f ticks/s, %.0f ticks/s per thread\n",
+            seconds, ticks / seconds, ticks / seconds / pool.size());
+        printf("Finished:    %zu (%.1f%%)\n", lapTimes.size(), 100.0 * lapTimes.size() / options.sessions);
+        if(!lapTimes.empty()) {
+            double sum = 0.0;
+            for(float t : lapTimes) {
+                sum += t;
+            }
+            printf("Lap time:    min %.2f  mean %.2f  p50 %.2f  p95 %.2f  max %.2f s\n",
+                lapTimes.front(), sum / lapTimes.size(),
+                percentile(lapTimes, 0.5f), percentile(lapTimes, 0.95f), lapTimes.back());
+        }
+        printf("Per session: %.1f checkpoints, %.1f bounces, %.1f power ups\n",
+            (double)checkpoints / options.sessions, (double)bounces / options.sessions,
+            (double)powerUps / options.sessions);
+
+        if(!options.csv.empty()) {
+            writeCsv(options.csv, results);
+            printf("Statistics:  %s\n", options.csv.c_str());
+        }
+    } catch (const std::exception& e) {
+        logError("%s", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+// Micro-benchmark of the collision queries of the character against the
+// asteroid field:
+//      - the loop used by GameModel::collision before the broad phase
+//        (copy of each collider, glm::distance)
+//      - ColliderStore, scalar, SSE and AVX2 kernels (AVX2 only if the CPU
+//        has it)
+//      - SpatialGrid
+// Run with `make bench`
+#include "collider_store.hpp"
+#include "spatial_grid.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Same layout and test as the game colliders
+struct ColliderObject {
+    glm::vec3 position;
+    float radius;
+    ColliderObject(glm::vec3 position, float radius): position(position), radius(radius) {}
+    bool collision(ColliderObject& other) {
+        return glm::distance(this->position, other.position)
+            < (this->radius + other.radius);
+    }
+};
+
+static volatile size_t sink;
+
+template <class F>
+static double nsPerQuery(int queries, F f) {
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t total = 0;
+    for(int q = 0; q < queries; q++) {
+        total += f(q);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    sink = total;
+    return std::chrono::duration<double, std::nano>(end - start).count() / queries;
+}
+
+int main() {
+    const int sizes[] = {15, 1000, 100000};
+    const int QUERY_POINTS = 1024;
+
+    const bool avx2 = ColliderStore::hasAVX2();
+    printf("SIMD kernel: %s\n\n", ColliderStore::kernel());
+    printf("%8s %12s %12s %12s %12s %12s %12s\n",
+        "N", "AoS loop", "SoA scalar", "SoA SSE", "SoA AVX2", "grid", "hits/query");
+
+    for(int n : sizes) {
+        // Keep the density of the current field: 15 asteroids in ~120^3
+        float side = 120.0f * std::cbrt(n / 15.0f);
+        std::mt19937 rng(n);
+        std::uniform_real_distribution<float>
+            coord(-side / 2, side / 2),
+            radius(2.0f, 7.0f);
+
+        std::vector<ColliderObject> asteroids;
+        ColliderStore store;
+        SpatialGrid grid;
+        for(int i = 0; i < n; i++) {
+            glm::vec3 p(coord(rng), coord(rng), coord(rng));
+            float r = radius(rng);
+            asteroids.push_back(ColliderObject(p, r));
+            store.add(p, r);
+            grid.insertStatic(p, r);
+        }
+
+        std::vector<ColliderObject> ships;
+        for(int q = 0; q < QUERY_POINTS; q++) {
+            ships.push_back(ColliderObject(
+                glm::vec3(coord(rng), coord(rng), coord(rng)), 0.5f));
+        }
+
+        // Small fields are timed on more repetitions
+        int queries = std::max(QUERY_POINTS, 20000000 / std::max(n, 1));
+        std::vector<int> hits;
+
+        double aos = nsPerQuery(queries, [&](int q) {
+            // old GameModel::collision, without the early exit so that every
+            // method computes all the hits
+            size_t found = 0;
+            for(ColliderObject el : asteroids) {
+                if(ships[q % QUERY_POINTS].collision(el)) {
+                    found++;
+                }
+            }
+            return found;
+        });
+        double scalar = nsPerQuery(queries, [&](int q) {
+            hits.clear();
+            return store.overlapsScalar(ships[q % QUERY_POINTS].position, 0.5f, hits);
+        });
+        double sse = nsPerQuery(queries, [&](int q) {
+            hits.clear();
+            return store.overlapsSSE(ships[q % QUERY_POINTS].position, 0.5f, hits);
+        });
+        double wide = !avx2 ? 0.0 : nsPerQuery(queries, [&](int q) {
+            hits.clear();
+            return store.overlapsAVX2(ships[q % QUERY_POINTS].position, 0.5f, hits);
+        });
+        double cells = nsPerQuery(queries, [&](int q) {
+            hits.clear();
+            return grid.query(ships[q % QUERY_POINTS].position, 0.5f, hits);
+        });
+
+        // Every method must agree on the hits
+        size_t expected = 0, sseHits = 0, avx2Hits = 0, gridHits = 0;
+        for(ColliderObject &ship : ships) {
+            for(ColliderObject el : asteroids) {
+                expected += ship.collision(el);
+            }
+            hits.clear();
+            sseHits += store.overlapsSSE(ship.position, 0.5f, hits);
+            hits.clear();
+            avx2Hits += store.overlapsAVX2(ship.position, 0.5f, hits);
+            hits.clear();
+            gridHits += grid.query(ship.position, 0.5f, hits);
+        }
+        if(sseHits != expected || avx2Hits != expected || gridHits != expected) {
+            printf("Mismatch at N=%d: %zu expected, %zu SSE, %zu AVX2, %zu grid\n",
+                n, expected, sseHits, avx2Hits, gridHits);
+            return 1;
+        }
+
+        char wideTime[16] = "n/a";
+        if(avx2) {
+            snprintf(wideTime, sizeof(wideTime), "%.1fns", wide);
+        }
+        printf("%8d %10.1fns %10.1fns %10.1fns %12s %10.1fns %12.3f\n",
+            n, aos, scalar, sse, wideTime, cells, (double)expected / QUERY_POINTS);
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+// Runs the simulation without window and GPU: steps a GameModel for a given
+// number of ticks, reports the ticks per second and the hash of the final
+// state. Two runs with the same options and script end with the same hash.
+//      --ticks <n>         ticks to simulate (default 12000, 100 s of game)
+//      --tick-rate <n>     simulation steps per second (default 120)
+//      --script <file>     inputs, without it the character stays still
+//      --trace <n>         print the hash every n ticks
+//      --seed <n> --asteroids <n> --crystals <n> --checkpoints <n>
+//                          procedural field instead of the hand made race
+// The script format is described in input_script.hpp, after its last line
+// the input is zero.
+// Run with `make headless ARGS="--script race.txt"`
+#include "game_model.hpp"
+#include "input_script.hpp"
+#include "log.h"
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+struct Options {
+    unsigned long ticks = 12000;
+    float tickRate = 120.0f;
+    unsigned long trace = 0;
+    std::string script;
+    bool proceduralField = false;
+    FieldParams field;
+};
+
+static bool parseArgs(int argc, char **argv, Options &options) {
+    for(int i = 1; i < argc; i++) {
+        if(i + 1 >= argc) {
+            logError("Missing value for %s", argv[i]);
+            return false;
+        }
+        try {
+            if(!strcmp(argv[i], "--ticks")) {
+                options.ticks = std::stoul(argv[++i]);
+            } else if(!strcmp(argv[i], "--tick-rate")) {
+                options.tickRate = std::stof(argv[++i]);
+                if(options.tickRate <= 0.0f) {
+                    throw std::invalid_argument("tick rate");
+                }
+            } else if(!strcmp(argv[i], "--trace")) {
+                options.trace = std::stoul(argv[++i]);
+            } else if(!strcmp(argv[i], "--script")) {
+                options.script = argv[++i];
+            } else if(!strcmp(argv[i], "--seed")) {
+                options.field.seed = std::stoul(argv[++i]);
+                options.proceduralField = true;
+            } else if(!strcmp(argv[i], "--asteroids")) {
+                options.field.asteroids = std::stoi(argv[++i]);
+                options.proceduralField = true;
+            } else if(!strcmp(argv[i], "--crystals")) {
+                options.field.powerUps = std::stoi(argv[++i]);
+                options.proceduralField = true;
+            } else if(!strcmp(argv[i], "--checkpoints")) {
+                options.field.checkpoints = std::stoi(argv[++i]);
+                options.proceduralField = true;
+            } else {
+                logError("Unknown option %s", argv[i]);
+                return false;
+            }
+        } catch (const std::exception& e) {
+            logError("Invalid value for %s", argv[i - 1]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    logSetLevel(LOG_LEVEL_INFO);
+
+    Options options;
+    if(!parseArgs(argc, argv, options)) {
+        return EXIT_FAILURE;
+    }
+
+    try {
+        InputScript script;
+        if(!options.script.empty()) {
+            script.load(options.script);
+        }
+        GameModel game = options.proceduralField ? GameModel(options.field) : GameModel();
+        const float deltaT = 1.0f / options.tickRate;
+        ScriptPlayer player(script);
+
+        auto start = std::chrono::steady_clock::now();
+        for(unsigned long t = 0; t < options.ticks; t++) {
+            game.step(deltaT, player.next());
+            if(options.trace && game.ticks % options.trace == 0) {
+                printf("tick %8lu  hash %016" PRIx64 "\n", game.ticks, game.hash());
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+
+        printf("Ticks:       %lu (%.1f s of game)\n", game.ticks, game.time);
+        printf("Wall time:   %.3f s, %.0f ticks/s\n", seconds, game.ticks / seconds);
+        printf("Position:    %.4f %.4f %.4f\n",
+            game.current.position.x, game.current.position.y, game.current.position.z);
+        printf("Checkpoint:  %d/%zu\n", game.curr_check(), game.checkpoints.size());
+        printf("Final hash:  %016" PRIx64 "\n", game.hash());
+    } catch (const std::exception& e) {
+        logError("%s", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
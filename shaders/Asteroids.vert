@@ -1,11 +1,17 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(set = 1, binding = 0) uniform UniformBufferObject {
+struct UniformBufferObject {
 	mat4 mvpMat;
 	mat4 mMat;
 	mat4 nMat;
-} ubo;
+};
+
+// One element for each asteroid, the field is drawn with a single
+// instanced draw call
+layout(std430, set = 1, binding = 0) readonly buffer AsteroidBuffer {
+	UniformBufferObject asteroids[];
+};
 
 layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inNorm;
@@ -18,6 +24,7 @@ layout(location = 2) out vec2 fragUV;
 layout(location = 3) out vec4 fragTan;
 
 void main() {
+    UniformBufferObject ubo = asteroids[gl_InstanceIndex];
     gl_Position = ubo.mvpMat * vec4(inPos, 1.0);
     fragPos = (ubo.mMat * vec4(inPos, 1.0)).xyz;
     fragNorm = mat3(ubo.nMat[0].xyz, ubo.nMat[1].xyz, ubo.nMat[2].xyz) * inNorm;
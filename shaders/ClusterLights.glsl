@@ -0,0 +1,52 @@
+// Clustered point lights, shared by Crystal.frag and Mesh.frag. The including
+// shader defines CLUSTER_SET, the set of its cluster bindings (0 to 4, the
+// binding 1 is left to the shader)
+
+// The froxel grid and the light list, see src/game/lights.cpp
+layout(set = CLUSTER_SET, binding = 0) uniform ClusterUniformBlock {
+	mat4 viewPrj;
+	vec4 eyePos;
+	float sliceScale;
+	float sliceBias;
+	uint tilesX;
+	uint tilesY;
+	uint slices;
+} cluster;
+
+struct PointLight {
+	vec4 position;	// w is the range
+	vec4 color;		// w is the distance of the full color
+};
+
+layout(std430, set = CLUSTER_SET, binding = 2) readonly buffer LightBuffer {
+	PointLight lights[];
+};
+
+// Offset in lightIndices and number of lights of each froxel
+layout(std430, set = CLUSTER_SET, binding = 3) readonly buffer ClusterBuffer {
+	uvec2 ranges[];
+};
+
+layout(std430, set = CLUSTER_SET, binding = 4) readonly buffer IndexBuffer {
+	uint lightIndices[];
+};
+
+// Lights of the froxel of a point, the grid built by GameMain::assignLights
+uvec2 clusterLights(vec3 pos) {
+	vec4 clip = cluster.viewPrj * vec4(pos, 1.0);
+	vec2 screen = clamp(clip.xy / clip.w * 0.5 + 0.5, 0.0, 0.9999);
+	uvec2 tile = uvec2(screen * vec2(cluster.tilesX, cluster.tilesY));
+	int slice = int(floor(log(max(clip.w, 1e-4)) * cluster.sliceScale + cluster.sliceBias));
+	uint z = uint(clamp(slice, 0, int(cluster.slices) - 1));
+	return ranges[(z * cluster.tilesY + tile.y) * cluster.tilesX + tile.x];
+}
+
+// Color of a point light reaching pos and its direction L, the decay is
+// windowed to reach 0 at the range of the light
+vec3 pointLight(PointLight light, vec3 pos, out vec3 L) {
+	vec3 d = light.position.xyz - pos;
+	float dist = max(length(d), 1e-4);
+	L = d / dist;
+	float window = clamp(1.0 - pow(dist / light.position.w, 4.0), 0.0, 1.0);
+	return light.color.rgb * (light.color.w / dist) * window * window;
+}
@@ -1,22 +1,17 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : require
 
 layout(location = 0) in vec3 fragPos;
 layout(location = 1) in vec3 fragNorm;
 
 layout(location = 0) out vec4 outColor;
 
-layout(set = 0, binding = 0) uniform GlobalUniformBufferObject {
-	vec3 lightPos;
-	vec4 lightColor;
-	vec3 eyePos;
-} gubo;
+#define CLUSTER_SET 0
+#include "ClusterLights.glsl"
 
 layout(set = 0, binding = 1) uniform sampler2D toonLight;
 
-const float beta = 1.0f;
-const float g = 3;	
-
 float t(float normDot) {
     normDot = clamp(abs(normDot), 0.01, 0.999);
     normDot = texture(toonLight, vec2(normDot, 0.5)).r;
@@ -51,15 +46,19 @@ vec3 BRDF(vec3 V, vec3 N, vec3 L, vec3 Md, vec3 Ms, float gamma) {
 
 void main() {
 	vec3 Norm = normalize(fragNorm);
-	vec3 EyeDir = normalize(gubo.eyePos - fragPos);
-	
-	vec3 lightDir = normalize(gubo.lightPos - fragPos);
-    vec3 lightColor = gubo.lightColor.rgb;
+	vec3 EyeDir = normalize(cluster.eyePos.xyz - fragPos);
 
     vec3 baseColor = vec3(1,0,1);
 
-	vec3 DiffSpec = BRDF(EyeDir, Norm, lightDir, baseColor, vec3(1.0f), 60.0f);
+	// only the lights of the froxel, the others do not reach the fragment
+	vec3 DiffSpec = vec3(0.0);
+	uvec2 range = clusterLights(fragPos);
+	for(uint i = range.x; i < range.x + range.y; i++) {
+		vec3 lightDir;
+		vec3 lightColor = pointLight(lights[lightIndices[i]], fragPos, lightDir);
+		DiffSpec += BRDF(EyeDir, Norm, lightDir, baseColor, vec3(1.0f), 60.0f) * lightColor;
+	}
 	vec3 Ambient = baseColor * 0.1f;
 	
-	outColor = vec4(clamp(0.95 * (DiffSpec) * lightColor.rgb + Ambient,0.0,1.0), 1.0f);
+	outColor = vec4(clamp(0.95 * DiffSpec + Ambient,0.0,1.0), 1.0f);
 }
\ No newline at end of file
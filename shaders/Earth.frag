@@ -15,21 +15,25 @@ layout(set = 0, binding = 0) uniform GlobalUniformBufferObject {
 
 layout(set = 1, binding = 1) uniform sampler2D tex;
 
-const float beta = 0.1f;
-const float g = 8;
+// Specialization constants, set by GameMain::specializeShading: the same
+// module is built into pipelines with different values, folded by the driver
+layout(constant_id = 0) const float beta = 0.1f;
+layout(constant_id = 1) const float g = 8.0f;
+layout(constant_id = 2) const float gamma = 160.0f;	// cosine power for the Blinn specular reflection
+layout(constant_id = 3) const float ambientScale = 0.125f;	// of the spherical harmonics
+layout(constant_id = 5) const bool specular = true;
 
-const float gamma = 160.0f;	// cosine power for the Blinn specular reflection
-
-// coefficients for the spehrical harmonics ambient light term
-const vec3 C00  = vec3( .38f, .43f, .45f)/8.0f;
-const vec3 C1m1 = vec3( .29f, .36f, .41f)/8.0f;
-const vec3 C10  = vec3( .04f, .03f, .01f)/8.0f;
-const vec3 C11  = vec3(-.10f,-.10f,-.09f)/8.0f;
-const vec3 C2m2 = vec3(-.06f,-.06f,-.04f)/8.0f;
-const vec3 C2m1 = vec3( .01f,-.01f,-.05f)/8.0f;
-const vec3 C20  = vec3(-.09f,-.13f,-.15f)/8.0f;
-const vec3 C21  = vec3(-.06f,-.05f,-.04f)/8.0f;
-const vec3 C22  = vec3( .02f, .00f,-.05f)/8.0f;
+// coefficients for the spehrical harmonics ambient light term, scaled by
+// ambientScale
+const vec3 C00  = vec3( .38f, .43f, .45f);
+const vec3 C1m1 = vec3( .29f, .36f, .41f);
+const vec3 C10  = vec3( .04f, .03f, .01f);
+const vec3 C11  = vec3(-.10f,-.10f,-.09f);
+const vec3 C2m2 = vec3(-.06f,-.06f,-.04f);
+const vec3 C2m1 = vec3( .01f,-.01f,-.05f);
+const vec3 C20  = vec3(-.09f,-.13f,-.15f);
+const vec3 C21  = vec3(-.06f,-.05f,-.04f);
+const vec3 C22  = vec3( .02f, .00f,-.05f);
 
 void main() {
 
@@ -52,10 +56,10 @@ void main() {
 	// (Diffusion + Specular model same as in Assignment 12)
 	vec3 Lambert = MD * clamp(dot(lightDir, N), 0, 1);
 	vec3 H = normalize(lightDir + V);
-	vec3 Blinn = MS * pow(clamp(dot(N, H), 0, 1), gamma);
+	vec3 Blinn = specular ? MS * pow(clamp(dot(N, H), 0, 1), gamma) : vec3(0.0);
 
 	// Ambient light using Spherical Harmonics
-	vec3 SphericalHarmonics = MA * (
+	vec3 SphericalHarmonics = MA * ambientScale * (
 		C00
 		+ N.x * C1m1
 		+ N.z * N.x * C10
@@ -1,5 +1,6 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : require
 
 layout(location = 0) in vec3 fragPos;
 layout(location = 1) in vec3 fragNorm;
@@ -15,20 +16,27 @@ layout(set = 0, binding = 0) uniform GlobalUniformBufferObject {
 
 layout(set = 1, binding = 1) uniform sampler2D tex;
 
-const float beta = 0.1f;
-const float g = 8;
+#define CLUSTER_SET 2
+#include "ClusterLights.glsl"
 
-vec3 BRDF(vec3 V, vec3 N, vec3 L, vec3 Md, vec3 Ms, float gamma) {
+// Specialization constants, set by GameMain::specializeShading (same ids as
+// Earth.frag and Asteroids.frag)
+layout(constant_id = 0) const float beta = 0.1f;
+layout(constant_id = 1) const float g = 8.0f;
+layout(constant_id = 2) const float gamma = 160.0f;
+layout(constant_id = 5) const bool specular = true;
+
+vec3 BRDF(vec3 V, vec3 N, vec3 L, vec3 Md, vec3 Ms) {
 	//vec3 V  - direction of the viewer
 	//vec3 N  - normal vector to the surface
 	//vec3 L  - light vector (from the light model)
 	//vec3 Md - main color of the surface
 	//vec3 Ms - specular color of the surface
-	//float gamma - Exponent for power specular term
+	//gamma - Exponent for power specular term, a specialization constant
 	
 	vec3 Lambert =Md*clamp(dot(L,N),0.0,1.0);
 	vec3 rx = -reflect(L,N);
-	vec3 Phong = Ms*pow(clamp(dot(V,rx),0.0,0.97f),gamma);
+	vec3 Phong = specular ? Ms*pow(clamp(dot(V,rx),0.0,0.97f),gamma) : vec3(0.0);
 
 	vec3 Lambert_Phong_light = Lambert + Phong;
 	return Lambert_Phong_light;
@@ -42,9 +50,16 @@ void main() {
 	vec3 lightDir = normalize(gubo.lightPos - fragPos);
 	vec3 lightColor = gubo.lightColor.rgb;
 
-	vec3 DiffSpec = BRDF(EyeDir, Norm, lightDir, texture(tex, fragUV).rgb, vec3(1.0f), 160.0f);
+	vec3 DiffSpec = BRDF(EyeDir, Norm, lightDir, texture(tex, fragUV).rgb, vec3(1.0f)) * lightColor;
+	// and the crystal lights near the ship
+	uvec2 range = clusterLights(fragPos);
+	for(uint i = range.x; i < range.x + range.y; i++) {
+		vec3 crystalDir;
+		vec3 crystalColor = pointLight(lights[lightIndices[i]], fragPos, crystalDir);
+		DiffSpec += BRDF(EyeDir, Norm, crystalDir, texture(tex, fragUV).rgb, vec3(1.0f)) * crystalColor;
+	}
 	vec3 Ambient = texture(tex, fragUV).rgb * 0.05f;
 
-	outColor = vec4(clamp(0.95 * (DiffSpec) * lightColor.rgb + Ambient,0.0,1.0), 1.0f);
+	outColor = vec4(clamp(0.95 * DiffSpec + Ambient,0.0,1.0), 1.0f);
 }
 
@@ -0,0 +1,22 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec2 fragNDC;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform SkyboxUniformBufferObject {
+	mat4 invViewPrj;
+	mat4 rotation;
+} ubo;
+
+layout(set = 0, binding = 1) uniform samplerCube sky;
+
+void main() {
+	// the ray through the pixel, from the near to the far plane
+	vec4 near = ubo.invViewPrj * vec4(fragNDC, 0.0, 1.0);
+	vec4 far = ubo.invViewPrj * vec4(fragNDC, 1.0, 1.0);
+	vec3 dir = far.xyz / far.w - near.xyz / near.w;
+	// the sky turns with rotation, look it up in its own frame
+	outColor = texture(sky, transpose(mat3(ubo.rotation)) * dir);
+}
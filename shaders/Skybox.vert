@@ -0,0 +1,12 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Fullscreen triangle at the far plane, no vertex buffer: the vertices are
+// (-1, -1), (3, -1) and (-1, 3), which cover the whole screen
+layout(location = 0) out vec2 fragNDC;
+
+void main() {
+	fragNDC = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2) * 2.0 - 1.0;
+	// a depth of 1, drawn where nothing else is
+	gl_Position = vec4(fragNDC, 1.0, 1.0);
+}
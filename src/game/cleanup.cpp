@@ -3,14 +3,20 @@
 void GameMain::pipelinesAndDescriptorSetsCleanup() {
 
     // Cleanup pipelines
-    PPlain.cleanup();
+    PSkybox.cleanup();
     PMesh.cleanup();
     PCrystal.cleanup();
     PAsteroids.cleanup();
+    PAsteroidsFar.cleanup();
     PTorus.cleanup();
     PSun.cleanup();
     PEarth.cleanup();
     PText.cleanup();
+    if(gpuCulling) {
+        PCullAsteroids.cleanup();
+        PHiZOccluders.cleanup();
+        PHiZDownsample.cleanup();
+    }
 
     // Cleanup Descriptor Sets
     DSUniverse.cleanup();
@@ -23,16 +29,16 @@ void GameMain::pipelinesAndDescriptorSetsCleanup() {
     DSBoost.cleanup();
 
     DSPToonLight.cleanup();
-    for(int i=0; i<ASTEROIDS; i++) {
-        DSAsteroids[i].cleanup();
-    }
-    for (int i=0; i<POWERUPS; i++) {
+    DSAsteroids.cleanup();
+    for (size_t i=0; i<DSCrystal.size(); i++) {
         DSCrystal[i].cleanup(); 
     }
    
 }
 
 void GameMain::localCleanup() {
+    // The simulation thread uses the game model
+    stopSimulation();
 
     // Cleanup Textures
     TUniverse.cleanup();
@@ -48,7 +54,6 @@ void GameMain::localCleanup() {
     TBoost.cleanup();
     // Cleanup Models
     MTorus.cleanup();
-    MUniverse.cleanup();
     MMesh.cleanup();
     MSun.cleanup();
     MEarth.cleanup();
@@ -70,11 +75,20 @@ void GameMain::localCleanup() {
 
     // Destroy pipelines
     PTorus.destroy();
-    PPlain.destroy();
+    PSkybox.destroy();
     PMesh.destroy();
     PAsteroids.destroy();
+    PAsteroidsFar.destroy();
     PSun.destroy();
     PEarth.destroy();
     PCrystal.destroy();
     PText.destroy();
+    if(gpuCulling) {
+        PCullAsteroids.destroy();
+        PHiZOccluders.destroy();
+        PHiZDownsample.destroy();
+    }
+
+    delete game;
+    game = nullptr;
 }
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "collider_store.hpp"
+
+// The AVX2 kernel is compiled for AVX2 whatever the flags, and only used
+// if the CPU running the game has it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RUNTIME_AVX2
+#endif
+
+#if defined(RUNTIME_AVX2) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Padding spheres are far away from everything, with radius 0
+#define FAR_AWAY 1e30f
+
+size_t ColliderStore::add(glm::vec3 position, float radius) {
+    size_t id = count++;
+    if(count > x.size()) {
+        size_t padded = (count + WIDTH - 1) / WIDTH * WIDTH;
+        x.resize(padded, FAR_AWAY);
+        y.resize(padded, FAR_AWAY);
+        z.resize(padded, FAR_AWAY);
+        r.resize(padded, 0.0f);
+    }
+    set(id, position, radius);
+    return id;
+}
+
+void ColliderStore::set(size_t id, glm::vec3 position, float radius) {
+    x[id] = position.x;
+    y[id] = position.y;
+    z[id] = position.z;
+    r[id] = radius;
+}
+
+void ColliderStore::reserve(size_t n) {
+    size_t padded = (n + WIDTH - 1) / WIDTH * WIDTH;
+    x.reserve(padded);
+    y.reserve(padded);
+    z.reserve(padded);
+    r.reserve(padded);
+}
+
+void ColliderStore::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    r.clear();
+    count = 0;
+}
+
+bool ColliderStore::hasAVX2() {
+#if defined(RUNTIME_AVX2)
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+size_t ColliderStore::overlaps(glm::vec3 position, float radius, std::vector<int> &hits) const {
+    if(hasAVX2()) {
+        return overlapsAVX2(position, radius, hits);
+    }
+#if defined(__SSE2__)
+    return overlapsSSE(position, radius, hits);
+#else
+    return overlapsScalar(position, radius, hits);
+#endif
+}
+
+const char* ColliderStore::kernel() {
+    if(hasAVX2()) {
+        return "AVX2";
+    }
+#if defined(__SSE2__)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+size_t ColliderStore::overlapsScalar(glm::vec3 position, float radius, std::vector<int> &hits) const {
+    size_t found = 0;
+    for(size_t i = 0; i < count; i++) {
+        float
+            dx = x[i] - position.x,
+            dy = y[i] - position.y,
+            dz = z[i] - position.z,
+            rr = r[i] + radius;
+        if(dx * dx + dy * dy + dz * dz < rr * rr) {
+            hits.push_back(i);
+            found++;
+        }
+    }
+    return found;
+}
+
+#if defined(__SSE2__)
+size_t ColliderStore::overlapsSSE(glm::vec3 position, float radius, std::vector<int> &hits) const {
+    size_t found = 0;
+    const __m128
+        qx = _mm_set1_ps(position.x),
+        qy = _mm_set1_ps(position.y),
+        qz = _mm_set1_ps(position.z),
+        qr = _mm_set1_ps(radius);
+    for(size_t i = 0; i < x.size(); i += 4) {
+        __m128
+            dx = _mm_sub_ps(_mm_load_ps(&x[i]), qx),
+            dy = _mm_sub_ps(_mm_load_ps(&y[i]), qy),
+            dz = _mm_sub_ps(_mm_load_ps(&z[i]), qz),
+            rr = _mm_add_ps(_mm_load_ps(&r[i]), qr);
+        __m128 d2 = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+            _mm_mul_ps(dz, dz));
+        int mask = _mm_movemask_ps(_mm_cmplt_ps(d2, _mm_mul_ps(rr, rr)));
+        while(mask) {
+            hits.push_back(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+            found++;
+        }
+    }
+    return found;
+}
+#else
+size_t ColliderStore::overlapsSSE(glm::vec3 position, float radius, std::vector<int> &hits) const {
+    return overlapsScalar(position, radius, hits);
+}
+#endif
+
+#if defined(RUNTIME_AVX2)
+__attribute__((target("avx2")))
+size_t ColliderStore::overlapsAVX2(glm::vec3 position, float radius, std::vector<int> &hits) const {
+    size_t found = 0;
+    const __m256
+        qx = _mm256_set1_ps(position.x),
+        qy = _mm256_set1_ps(position.y),
+        qz = _mm256_set1_ps(position.z),
+        qr = _mm256_set1_ps(radius);
+    for(size_t i = 0; i < x.size(); i += 8) {
+        __m256
+            dx = _mm256_sub_ps(_mm256_load_ps(&x[i]), qx),
+            dy = _mm256_sub_ps(_mm256_load_ps(&y[i]), qy),
+            dz = _mm256_sub_ps(_mm256_load_ps(&z[i]), qz),
+            rr = _mm256_add_ps(_mm256_load_ps(&r[i]), qr);
+        __m256 d2 = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+            _mm256_mul_ps(dz, dz));
+        int mask = _mm256_movemask_ps(
+            _mm256_cmp_ps(d2, _mm256_mul_ps(rr, rr), _CMP_LT_OQ));
+        while(mask) {
+            hits.push_back(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+            found++;
+        }
+    }
+    return found;
+}
+#else
+size_t ColliderStore::overlapsAVX2(glm::vec3 position, float radius, std::vector<int> &hits) const {
+    return overlapsSSE(position, radius, hits);
+}
+#endif
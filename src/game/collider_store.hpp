@@ -0,0 +1,72 @@
+#ifndef COLLIDER_STORE_HPP
+#define COLLIDER_STORE_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Minimal allocator returning memory aligned to Align bytes
+template <class T, size_t Align>
+struct AlignedAllocator {
+    typedef T value_type;
+    template <class U> struct rebind { typedef AlignedAllocator<U, Align> other; };
+
+    AlignedAllocator() = default;
+    template <class U>
+    AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+    T* allocate(size_t n) {
+        // aligned_alloc wants a size multiple of the alignment
+        size_t bytes = (n * sizeof(T) + Align - 1) / Align * Align;
+        void *p = std::aligned_alloc(Align, bytes);
+        if(p == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(p);
+    }
+    void deallocate(T* p, size_t) {
+        std::free(p);
+    }
+    template <class U>
+    bool operator==(const AlignedAllocator<U, Align>&) const { return true; }
+    template <class U>
+    bool operator!=(const AlignedAllocator<U, Align>&) const { return false; }
+};
+
+// Bounding spheres stored as structure of arrays, so that a query sphere can
+// be tested against 8 (AVX2) or 4 (SSE) of them with a single instruction.
+// The arrays are 32 byte aligned and padded to a multiple of the SIMD width
+// with spheres which never overlap anything, so the kernels have no tail
+class ColliderStore {
+public:
+    static const size_t WIDTH = 8;
+    typedef std::vector<float, AlignedAllocator<float, 32>> Array;
+private:
+    Array x, y, z, r;
+    size_t count = 0;
+public:
+    // returns the id of the new sphere (its index)
+    size_t add(glm::vec3 position, float radius);
+    void set(size_t id, glm::vec3 position, float radius);
+    void reserve(size_t n);
+    void clear();
+    inline size_t size() const { return count; }
+
+    // Append to hits the ids of the spheres overlapping the given one,
+    // returns the number of ids appended. The fastest kernel is used: AVX2
+    // if the CPU has it, otherwise SSE, which is always on x86_64
+    size_t overlaps(glm::vec3 position, float radius, std::vector<int> &hits) const;
+    size_t overlapsScalar(glm::vec3 position, float radius, std::vector<int> &hits) const;
+    size_t overlapsSSE(glm::vec3 position, float radius, std::vector<int> &hits) const;
+    // falls back to overlapsSSE without AVX2
+    size_t overlapsAVX2(glm::vec3 position, float radius, std::vector<int> &hits) const;
+
+    // True if the CPU runs the AVX2 kernel
+    static bool hasAVX2();
+    // Name of the kernel used by overlaps()
+    static const char* kernel();
+};
+
+#endif//COLLIDER_STORE_HPP
@@ -0,0 +1,124 @@
+// Frustum culling of the scene objects, the ship, the universe and the HUD
+// are always drawn. With occlusionCulling the crystals hidden by the sun or
+// the Earth are skipped as well (the asteroids are tested on the GPU)
+#include "game_main.hpp"
+#include "log.h"
+#include <algorithm>
+#include <cmath>
+
+// Farthest vertex from the origin of the model
+template <class Vert>
+static float meshRadius(const Model<Vert> &M) {
+    float r2 = 0.0f;
+    for(const Vert &v : M.vertices) {
+        r2 = glm::max(r2, glm::dot(v.pos, v.pos));
+    }
+    return std::sqrt(r2);
+}
+
+// True if the sphere is entirely behind the occluder seen from the eye: its
+// cone of view is inside the one of the occluder and it is farther than the
+// center of the occluder, which is farther than the occluder surface along
+// every ray of the occluder cone
+static bool hiddenBehind(const glm::vec3 &eye, const glm::vec3 &center, float radius,
+                         const glm::vec3 &occluder, float occluderRadius) {
+    glm::vec3 toOccluder = occluder - eye, toSphere = center - eye;
+    float occluderDistance = glm::length(toOccluder), distance = glm::length(toSphere);
+    if(occluderDistance <= occluderRadius || distance - radius < occluderDistance) {
+        return false;
+    }
+    float cosine = glm::dot(toOccluder, toSphere) / (occluderDistance * distance);
+    float angle = std::acos(glm::clamp(cosine, -1.0f, 1.0f));
+    return angle + std::asin(radius / distance) <= std::asin(occluderRadius / occluderDistance);
+}
+
+// Nearest plane of a triangle to the origin of the model, the model
+// contains the sphere of this radius if it is convex
+template <class Vert>
+static float meshInnerRadius(const Model<Vert> &M) {
+    float r = INFINITY;
+    for(size_t i = 0; i + 2 < M.indices.size(); i += 3) {
+        const glm::vec3 &a = M.vertices[M.indices[i]].pos;
+        glm::vec3 n = glm::cross(M.vertices[M.indices[i + 1]].pos - a, M.vertices[M.indices[i + 2]].pos - a);
+        if(glm::dot(n, n) > 0.0f) {
+            r = glm::min(r, std::abs(glm::dot(glm::normalize(n), a)));
+        }
+    }
+    return std::isfinite(r) ? r : 0.0f;
+}
+
+void GameMain::initBounds() {
+    bounds.asteroid = meshRadius(MAsteroids);
+    bounds.crystal = meshRadius(MCrystal);
+    bounds.torus = meshRadius(MTorus);
+    bounds.sphere = meshRadius(MSun);
+    bounds.ship = meshRadius(MMesh);
+    bounds.sphereInner = meshInnerRadius(MSun);
+    logDebug("Bounding radii: asteroid %.2f, crystal %.2f, torus %.2f, sphere %.2f (%.2f inside)",
+        bounds.asteroid, bounds.crystal, bounds.torus, bounds.sphere, bounds.sphereInner);
+}
+
+void GameMain::cullScene(GameModel& game) {
+    Visibility &v = visibility;
+    v.frustum = Frustum(view.ViewPrj);
+    v.asteroids.clear();
+    v.crystals.clear();
+
+    // same scale as the model matrices built in drawScreen, the rotations
+    // are around the origin of the models and do not move the spheres
+    // (with gpuCulling the asteroids are tested by CullAsteroids.comp)
+    const float asteroidScale = bounds.asteroid * maxScale(Uast) * ASTEROID_SCALE;
+    for(size_t i = 0; !gpuCulling && i < game.asteroids.size(); i++) {
+        if(v.frustum.sphere(game.asteroids[i].position, asteroidScale * game.asteroids[i].radius)) {
+            v.asteroids.push_back(i);
+        }
+    }
+    const float crystalRadius = bounds.crystal * maxScale(UCrystal);
+    // the sphere models are uniformly scaled
+    const float sunInner = bounds.sphereInner * maxScale(USun);
+    const float earthInner = bounds.sphereInner * maxScale(UEarth);
+    v.occludedCrystals = 0;
+    for(size_t i = 0; i < game.powerUps.size(); i++) {
+        const glm::vec3 &p = game.powerUps[i].position;
+        if(!v.frustum.sphere(p, crystalRadius)) {
+            continue;
+        }
+        if(occlusionCulling &&
+           (hiddenBehind(view.state.camera, p, crystalRadius, game.sun.position, sunInner) ||
+            hiddenBehind(view.state.camera, p, crystalRadius, game.Earth.position, earthInner))) {
+            v.occludedCrystals++;
+            continue;
+        }
+        v.crystals.push_back(i);
+    }
+    v.sun = v.frustum.sphere(game.sun.position, bounds.sphere * maxScale(USun));
+    v.earth = v.frustum.sphere(game.Earth.position, bounds.sphere * maxScale(UEarth));
+    v.checkpoint = v.frustum.sphere(game.checkpoints[view.checkpoint].position, bounds.torus);
+
+    size_t total = (gpuCulling ? 0 : game.asteroids.size()) + game.powerUps.size() + 3;
+    v.visible = v.asteroids.size() + v.crystals.size() + v.sun + v.earth + v.checkpoint;
+    v.culled = total - v.visible;
+
+    if(logStats) {
+        if(occlusionCulling && cullingStatistics) {
+            // counted by CullAsteroids.comp
+            uint32_t occluded = v.gpuOccluded;
+            logDebug("Culling: %zu visible, %zu culled (%u/%zu asteroids on the GPU, "
+                "%u/%u in view occluded, %.1f%%, %zu crystals occluded)",
+                v.visible, v.culled, v.gpuAsteroids, game.asteroids.size(),
+                occluded, v.gpuInFrustum,
+                v.gpuInFrustum ? 100.0 * occluded / v.gpuInFrustum : 0.0,
+                v.occludedCrystals);
+        } else if(gpuCulling && cullingStatistics) {
+            logDebug("Culling: %zu visible, %zu culled (%u/%zu asteroids on the GPU)",
+                v.visible, v.culled, v.gpuAsteroids, game.asteroids.size());
+        } else if(gpuCulling) {
+            logDebug("Culling: %zu visible, %zu culled (asteroids on the GPU, "
+                "%zu crystals occluded)",
+                v.visible, v.culled, v.occludedCrystals);
+        } else {
+            logDebug("Culling: %zu visible, %zu culled (%zu/%zu asteroids)",
+                v.visible, v.culled, v.asteroids.size(), game.asteroids.size());
+        }
+    }
+}
@@ -16,122 +16,171 @@ void GameMain::drawScreen(GameModel& game, uint32_t currentImage) {
     //          1. The object to pass, containing data for the mapping
     //          2. Its size
     // Set universe properties and map it
-    uboUniverse.mMat = UGWM
-        * glm::rotate(
+    uboUniverse.rotation = glm::rotate(
             I,
-            glm::radians(1.0f) * game.time,
+            glm::radians(1.0f) * view.state.time,
             glm::vec3(1,0,0));
-    uboUniverse.mvpMat = game.ViewPrj * uboUniverse.mMat;
+    uboUniverse.invViewPrj = glm::inverse(view.ViewPrj);
     DSUniverse.map(currentImage, &uboUniverse, sizeof(uboUniverse), 0);
     
     // Set sunlight properties and map it
-    guboPLSun.lightPos = game.sun->position;
+    guboPLSun.lightPos = game.sun.position;
     guboPLSun.lightColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
-    guboPLSun.eyePos = game.camera->position;
+    guboPLSun.eyePos = view.state.camera;
     DSSunLight.map(currentImage, &guboPLSun, sizeof(guboPLSun), 0);
 
+    // Only the objects which survived cullScene are updated
     // Set sun model properteies and map it
-    uboSun.mMat = glm::translate(I, game.sun->position)* glm::rotate(
-            I,
-            glm::radians(3.0f) * 
-            game.time,
-            glm::vec3(0,0,1))*
-            USun;
-    uboSun.mvpMat = game.ViewPrj * uboSun.mMat;
-    uboSun.time = game.time;
-    DSSun.map(currentImage,&uboSun, sizeof(uboSun), 0);
+    if(visibility.sun) {
+        uboSun.mMat = glm::translate(I, game.sun.position)* glm::rotate(
+                I,
+                glm::radians(3.0f) * 
+                view.state.time,
+                glm::vec3(0,0,1))*
+                USun;
+        uboSun.mvpMat = view.ViewPrj * uboSun.mMat;
+        uboSun.time = view.state.time;
+        DSSun.map(currentImage,&uboSun, sizeof(uboSun), 0);
+    }
 
     // Set Earth model properteies and map it
-    uboEarth.mMat = glm::translate(I, game.Earth->position)* 
-        glm::rotate(
-            I,
-            glm::radians(90.0f),
-            glm::vec3(1,0,0))* 
-        glm::rotate(
-            I,
-            glm::radians(5.0f)*game.time,
-            glm::vec3(0,1,0))* 
-            UEarth;
-    uboEarth.mvpMat = game.ViewPrj * uboEarth.mMat;
-    uboEarth.nMat = glm::inverse(glm::transpose(uboEarth.mMat));
-    DSEarth.map(currentImage,&uboEarth, sizeof(uboEarth), 0);
+    if(visibility.earth) {
+        uboEarth.mMat = glm::translate(I, game.Earth.position)* 
+            glm::rotate(
+                I,
+                glm::radians(90.0f),
+                glm::vec3(1,0,0))* 
+            glm::rotate(
+                I,
+                glm::radians(5.0f)*view.state.time,
+                glm::vec3(0,1,0))* 
+                UEarth;
+        uboEarth.mvpMat = view.ViewPrj * uboEarth.mMat;
+        uboEarth.nMat = glm::inverse(glm::transpose(uboEarth.mMat));
+        DSEarth.map(currentImage,&uboEarth, sizeof(uboEarth), 0);
+    }
 
     
     // Set mesh properties and map it
     // NEEDS SunLight to be set
-    uboMesh.mMat = game.World;
-    uboMesh.mvpMat = game.fixed_ViewPrj * uboMesh.mMat;
+    uboMesh.mMat = view.World;
+    uboMesh.mvpMat = view.fixed_ViewPrj * uboMesh.mMat;
     uboMesh.nMat = glm::inverse(glm::transpose(uboMesh.mMat));
     DSMesh.map(currentImage, &uboMesh, sizeof(uboMesh), 0);
 
-    for(int i = 0; i<ASTEROIDS; i++) {
-        // Set mesh properties and map it
+    if(gpuCulling && !game.asteroids.empty()) {
+        // Asteroids culled by CullAsteroids.comp, the last frame drawn with
+        // this image is complete: read its counts if logged, then reset the
+        // command
+        AsteroidDraw draw;
+        if(cullingStatistics) {
+            DSAsteroids.read(currentImage, &draw, sizeof(draw), 4);
+            visibility.gpuAsteroids = draw.draw.instanceCount;
+            visibility.gpuInFrustum = draw.inFrustum;
+            visibility.gpuOccluded = draw.occluded;
+        }
+        draw = {};
+        draw.draw.indexCount = static_cast<uint32_t>(MAsteroids.indices.size());
+        DSAsteroids.map(currentImage, &draw, sizeof(draw), 4);
+
+        uboCull.viewPrj = view.ViewPrj;
+        uboCull.invViewPrj = glm::inverse(view.ViewPrj);
+        for(int i = 0; i < 6; i++) {
+            uboCull.planes[i] = visibility.frustum.plane(i);
+        }
+        // the sphere models are uniformly scaled
+        uboCull.occluders[0] = glm::vec4(game.sun.position, bounds.sphereInner * maxScale(USun));
+        uboCull.occluders[1] = glm::vec4(game.Earth.position, bounds.sphereInner * maxScale(UEarth));
+        uboCull.hizSize = HIZ_SIZE;
+        uboCull.hizLevels = 0;
+        for(uint32_t side = HIZ_SIZE; occlusionCulling && side > 0; side /= 2) {
+            uboCull.hizLevels++;
+        }
+        uboCull.time = view.state.time;
+        // Uast is a uniform scale
+        uboCull.modelScale = maxScale(Uast) * ASTEROID_SCALE;
+        uboCull.boundRadius = bounds.asteroid;
+        uboCull.count = static_cast<uint32_t>(game.asteroids.size());
+        DSAsteroids.map(currentImage, &uboCull, sizeof(uboCull), 5);
+    }
+
+    const std::vector<uint32_t> &asteroids = visibility.asteroids;
+    for(size_t k = 0; k<asteroids.size(); k++) {
+        // Set mesh properties, the visible asteroids are packed at the
+        // beginning of the buffer and mapped at once
         // NEEDS SunLight to be set
-        uboMesh.mMat =
+        uint32_t i = asteroids[k];
+        MeshUniformBlock &ubo = uboAsteroids[k];
+        ubo.mMat =
             glm::translate(
                 I, 
                 game.asteroids[i].position)
             * Uast
-            * glm::scale(I, glm::vec3(game.asteroids[i].radius * 1.2))
+            * glm::scale(I, glm::vec3(game.asteroids[i].radius * ASTEROID_SCALE))
             * glm::rotate(
                 I,
                 glm::radians(20.0f)
-                * game.time,
+                * view.state.time,
                 glm::normalize(
                     game.asteroids[i].position
                     + glm::vec3(0,1,0)));
-        uboMesh.mvpMat = game.ViewPrj * uboMesh.mMat;
-        uboMesh.nMat = glm::inverse(glm::transpose(uboMesh.mMat));
-        DSAsteroids[i].map(currentImage, &uboMesh, sizeof(uboMesh), 0);
+        ubo.mvpMat = view.ViewPrj * ubo.mMat;
+        ubo.nMat = glm::inverse(glm::transpose(ubo.mMat));
+    }
+    if(!asteroids.empty()) {
+        DSAsteroids.map(currentImage, uboAsteroids.data(),
+            sizeof(MeshUniformBlock) * asteroids.size(), 0);
     }
 
-    uboTorus.mMat =
-        glm::translate(
-            I,
-            game.checkpoints[game.curr_check()].position)
-        * glm::rotate(
-            I,
-            game.checkpoints[game.curr_check()].rotation_angle,
-            game.checkpoints[game.curr_check()].rotation_vec);
-    uboTorus.mvpMat = game.ViewPrj * uboTorus.mMat;
-    uboTorus.nMat = glm::inverse(glm::transpose(uboTorus.mMat));
+    if(visibility.checkpoint) {
+        uboTorus.mMat =
+            glm::translate(
+                I,
+                game.checkpoints[view.checkpoint].position)
+            * glm::rotate(
+                I,
+                game.checkpoints[view.checkpoint].rotation_angle,
+                game.checkpoints[view.checkpoint].rotation_vec);
+        uboTorus.mvpMat = view.ViewPrj * uboTorus.mMat;
+        uboTorus.nMat = glm::inverse(glm::transpose(uboTorus.mMat));
 
-    DSTorus.map(currentImage, &uboTorus, sizeof(uboTorus), 0);
+        DSTorus.map(currentImage, &uboTorus, sizeof(uboTorus), 0);
+    }
 
-    for(int i = 0; i<POWERUPS; i++) {
-        // Set sunlight properties and map it
-        guboPLCrystal.lightPos = game.powerUps[i].position + glm::vec3(
-            glm::cos(
-                glm::radians(40.0f)
-                * game.time),
-            glm::sin(
-                glm::radians(40.0f)
-                * game.time),
-            0);
-        guboPLCrystal.lightColor = glm::vec4(5);
-        guboPLCrystal.eyePos = game.camera->position;
-        DSPToonLight.map(currentImage, &guboPLCrystal, sizeof(guboPLCrystal), 0);
+    // The lights of all the crystals at once, assigned to the froxels by
+    // assignLights
+    DSPToonLight.map(currentImage, &uboClusters, sizeof(uboClusters), 0);
+    if(!clusters.lights.empty()) {
+        DSPToonLight.map(currentImage, clusters.lights.data(),
+            sizeof(PointLight) * clusters.lights.size(), 2);
+    }
+    DSPToonLight.map(currentImage, clusters.ranges.data(),
+        sizeof(glm::uvec2) * clusters.ranges.size(), 3);
+    if(!clusters.indices.empty()) {
+        DSPToonLight.map(currentImage, clusters.indices.data(),
+            sizeof(uint32_t) * clusters.indices.size(), 4);
+    }
 
+    for(uint32_t i : visibility.crystals) {
         uboCrystal.mMat =
             glm::translate(
                 I,
                 game.powerUps[i].position)
-            * glm::scale(
-                I, 
-                glm::vec3(0.5))
+            * UCrystal
             * glm::rotate(
                 I, 
                 glm::radians(30.0f)
-                * game.time,
+                * view.state.time,
                 glm::vec3(1,0,0));
-        uboCrystal.mvpMat = game.ViewPrj * uboCrystal.mMat;
+        uboCrystal.mvpMat = view.ViewPrj * uboCrystal.mMat;
         uboCrystal.nMat = glm::inverse(glm::transpose(uboCrystal.mMat));
         DSCrystal[i].map(currentImage, &uboCrystal, sizeof(uboCrystal), 0);
     }
 
-        uboText.visible=game.visiblecommands; //Sets if text overlay is visible or invisible
-        if(game.time>10) game.visiblecommands=false; //if ten seconds have passed delete the overlay
+        uboText.visible=view.state.time<=10; //if ten seconds have passed delete the overlay
 		DSText.map(currentImage, &uboText, sizeof(uboText), 0);
 
+        uboBoost.visible=view.boost; //the boost icon is shown while there is boost left
+
         DSBoost.map(currentImage, &uboBoost, sizeof(uboBoost), 0);
 }
\ No newline at end of file
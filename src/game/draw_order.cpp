@@ -0,0 +1,113 @@
+// Render queue of the frame: every visible object submits its draws with
+// its pipeline, descriptor sets, mesh and distance, the queue sorts them by
+// key and records them binding only what changes (see
+// src/lib/render_queue.hpp). With frontToBack the draws go front to back by
+// octaves of distance, and by state within an octave, so that the early
+// depth test rejects what they hide, and the universe, which is at the far
+// plane, goes after the opaque objects and is only shaded where nothing
+// else is
+#include "game_main.hpp"
+#include "log.h"
+#include <algorithm>
+#include <cmath>
+
+void GameMain::sortDraws(GameModel& game, uint32_t currentImage) {
+    if(logStats) {
+        // of the last frame recorded, before the queue is refilled
+        RenderQueue::Stats binds;
+        for(const RenderQueue::Stats &s : recordStats) {
+            binds += s;
+        }
+        logDebug("Render queue: %zu draws, %zu pipeline, %zu descriptor set and %zu mesh binds "
+            "(%zu redundant skipped)",
+            binds.draws, binds.pipelines, binds.descriptorSets, binds.meshes, binds.skipped);
+    }
+
+    Visibility &v = visibility;
+    // all with normal map unless sorted
+    v.nearAsteroids = v.asteroids.size();
+
+    // distance along the view direction of the nearest point of the
+    // sphere, as a fraction of the far plane for the keys
+    auto depth = [this](const glm::vec4 &clip, float radius) {
+        return frontToBack ? (clip.w - radius) / view.farPlane : 0.0f;
+    };
+    auto sceneDepth = [&](const glm::vec3 &center, float radius) {
+        return depth(view.ViewPrj * glm::vec4(center, 1.0f), radius);
+    };
+
+    // Pipelines and meshes are numbered in the order they are submitted the
+    // first time: the ship, then the large objects, first within the pass
+    renderQueue.clear();
+    // the ship is drawn with its own camera
+    renderQueue.submit(OPAQUE_PASS, PMesh, {&DSSunLight, &DSMesh, &DSPToonLight}, MMesh,
+        depth(view.fixed_ViewPrj * view.World[3], bounds.ship * maxScale(view.World)));
+    if(v.earth) {
+        renderQueue.submit(OPAQUE_PASS, PEarth, {&DSSunLight, &DSEarth}, MEarth,
+            sceneDepth(game.Earth.position, bounds.sphere * maxScale(UEarth)));
+    }
+    if(v.sun) {
+        renderQueue.submit(OPAQUE_PASS, PSun, {&DSSun}, MSun,
+            sceneDepth(game.sun.position, bounds.sphere * maxScale(USun)));
+    }
+
+    // gl_InstanceIndex selects the matrices of the asteroid, only the
+    // visible ones are in the buffer
+    if(gpuCulling && !game.asteroids.empty()) {
+        // the instance count is written by CullAsteroids.comp, which does
+        // not keep an order: the field is around the ship anyway
+        RenderQueue::Draw &field = renderQueue.submit(OPAQUE_PASS, PAsteroids,
+            {&DSSunLight, &DSAsteroids}, MAsteroids);
+        field.indirect = DSAsteroids.uniformBuffers[4][currentImage];
+    } else if(!v.asteroids.empty()) {
+        // the asteroids are packed in the instance buffer in the order of
+        // visibility: sort it front to back, the far ones are drawn by a
+        // variant without normal map, instances from nearAsteroids
+        const float asteroidScale = bounds.asteroid * maxScale(Uast) * ASTEROID_SCALE;
+        std::vector<std::pair<float, uint32_t>> keys;
+        for(uint32_t i = 0; frontToBack && i < v.asteroids.size(); i++) {
+            const Asteroid &a = game.asteroids[v.asteroids[i]];
+            keys.emplace_back((view.ViewPrj * glm::vec4(a.position, 1.0f)).w - asteroidScale * a.radius,
+                v.asteroids[i]);
+        }
+        std::sort(keys.begin(), keys.end());
+        for(size_t k = 0; k < keys.size(); k++) {
+            v.asteroids[k] = keys[k].second;
+        }
+        if(!keys.empty()) {
+            v.nearAsteroids = std::partition_point(keys.begin(), keys.end(),
+                [](const std::pair<float, uint32_t> &k) { return k.first < NORMAL_MAP_DISTANCE; }) - keys.begin();
+        }
+        float nearest = keys.empty() ? 0.0f : std::max(keys.front().first, 0.0f) / view.farPlane;
+
+        if(v.nearAsteroids > 0) {
+            RenderQueue::Draw &closeBy = renderQueue.submit(OPAQUE_PASS, PAsteroids,
+                {&DSSunLight, &DSAsteroids}, MAsteroids, nearest);
+            closeBy.instances = static_cast<uint32_t>(v.nearAsteroids);
+        }
+        if(v.nearAsteroids < v.asteroids.size()) {
+            RenderQueue::Draw &distant = renderQueue.submit(OPAQUE_PASS, PAsteroidsFar,
+                {&DSSunLight, &DSAsteroids}, MAsteroids, nearest);
+            distant.instances = static_cast<uint32_t>(v.asteroids.size() - v.nearAsteroids);
+            distant.firstInstance = static_cast<uint32_t>(v.nearAsteroids);
+        }
+    }
+
+    if(v.checkpoint) {
+        renderQueue.submit(OPAQUE_PASS, PTorus, {&DSSunLight, &DSTorus}, MTorus,
+            sceneDepth(game.checkpoints[view.checkpoint].position, bounds.torus));
+    }
+    const float crystalRadius = bounds.crystal * maxScale(UCrystal);
+    for(uint32_t i : v.crystals) {
+        renderQueue.submit(OPAQUE_PASS, PCrystal, {&DSPToonLight, &DSCrystal[i]}, MCrystal,
+            sceneDepth(game.powerUps[i].position, crystalRadius));
+    }
+
+    // no vertex buffer, the three vertices come from gl_VertexIndex
+    renderQueue.submit(frontToBack ? SKY_LAST_PASS : SKY_FIRST_PASS, PSkybox, {&DSUniverse}, 3);
+    renderQueue.submit(OVERLAY_PASS, PText, {&DSText}, MText);
+    renderQueue.submit(OVERLAY_PASS, PText, {&DSBoost}, MBoost);
+    renderQueue.sort();
+    // written again by the recording of the frame
+    recordStats.fill({});
+}
@@ -0,0 +1,199 @@
+#include "field_generator.hpp"
+#include "log.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// Candidates tried around each active sample before retiring it
+#define POISSON_ATTEMPTS 30
+// Refuse background grids bigger than this (cells)
+#define POISSON_MAX_CELLS (1 << 27)
+
+// PCG32, small and with the same sequence everywhere
+class FieldRandom {
+    uint64_t state;
+public:
+    FieldRandom(uint32_t seed) {
+        state = 0x853c49e6748fea9bull + seed;
+        next();
+    }
+    uint32_t next() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ull + 1442695040888963407ull;
+        uint32_t xorshifted = ((old >> 18u) ^ old) >> 27u;
+        uint32_t rot = old >> 59u;
+        return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+    }
+    // uniform in [0, 1)
+    float uniform() {
+        return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+    float uniform(float a, float b) {
+        return a + (b - a) * uniform();
+    }
+    // uniform in [0, n)
+    uint32_t below(uint32_t n) {
+        return (uint32_t)(((uint64_t)next() * n) >> 32);
+    }
+    // uniform on the unit sphere
+    glm::vec3 direction() {
+        float z = uniform(-1.0f, 1.0f);
+        float phi = uniform(0.0f, 2.0f * (float)M_PI);
+        float s = std::sqrt(1.0f - z * z);
+        return glm::vec3(s * std::cos(phi), s * std::sin(phi), z);
+    }
+};
+
+std::vector<glm::vec3> poissonDisk(float radius, float spacing, uint32_t seed) {
+    FieldRandom rng(seed);
+
+    // each cell can hold at most one sample
+    const float cell = spacing / std::sqrt(3.0f);
+    const int side = (int)std::ceil(2.0f * radius / cell) + 1;
+    if((double)side * side * side > POISSON_MAX_CELLS) {
+        throw std::runtime_error("Field too big for the given spacing");
+    }
+    std::vector<int> grid((size_t)side * side * side, -1);
+    auto cellOf = [&](glm::vec3 p) {
+        return glm::ivec3(glm::floor((p + radius) / cell));
+    };
+    auto index = [&](glm::ivec3 c) {
+        return ((size_t)c.z * side + c.y) * side + c.x;
+    };
+
+    std::vector<glm::vec3> samples;
+    std::vector<int> active;
+    samples.push_back(glm::vec3(0.0f));
+    active.push_back(0);
+    grid[index(cellOf(samples[0]))] = 0;
+
+    const float spacing2 = spacing * spacing;
+    while(!active.empty()) {
+        uint32_t a = rng.below(active.size());
+        glm::vec3 center = samples[active[a]];
+
+        bool found = false;
+        for(int k = 0; k < POISSON_ATTEMPTS && !found; k++) {
+            // uniform in the shell between spacing and 2 * spacing
+            glm::vec3 p = center + rng.direction() * spacing * std::cbrt(rng.uniform(1.0f, 8.0f));
+            if(glm::dot(p, p) > radius * radius) {
+                continue;
+            }
+            // samples closer than spacing are at most 2 cells away
+            glm::ivec3 c = cellOf(p);
+            bool far = true;
+            for(int z = std::max(c.z - 2, 0); far && z <= std::min(c.z + 2, side - 1); z++) {
+                for(int y = std::max(c.y - 2, 0); far && y <= std::min(c.y + 2, side - 1); y++) {
+                    for(int x = std::max(c.x - 2, 0); far && x <= std::min(c.x + 2, side - 1); x++) {
+                        int other = grid[index(glm::ivec3(x, y, z))];
+                        if(other >= 0) {
+                            glm::vec3 d = samples[other] - p;
+                            far = glm::dot(d, d) >= spacing2;
+                        }
+                    }
+                }
+            }
+            if(far) {
+                grid[index(c)] = samples.size();
+                active.push_back(samples.size());
+                samples.push_back(p);
+                found = true;
+            }
+        }
+        if(!found) {
+            active[a] = active.back();
+            active.pop_back();
+        }
+    }
+    return samples;
+}
+
+Field generateField(const FieldParams &params) {
+    if(params.asteroids < 0 || params.powerUps < 0 || params.checkpoints < 1) {
+        throw std::runtime_error("A field needs at least one checkpoint");
+    }
+    if(params.spacing < 2.0f * params.minRadius) {
+        throw std::runtime_error("Field spacing smaller than the asteroids");
+    }
+    size_t total = params.asteroids + params.powerUps + params.checkpoints;
+
+    // Bridson fills about 0.6 samples per spacing^3, start from a ball which
+    // should hold all the objects and grow it until the sampling has enough
+    // room (the origin does not count)
+    float radius = params.spacing * (std::cbrt(3.0f * total / (2.0f * (float)M_PI)) + 1.0f);
+    std::vector<glm::vec3> samples;
+    for(;;) {
+        samples = poissonDisk(radius, params.spacing, params.seed);
+        if(samples.size() > total) {
+            break;
+        }
+        radius *= 1.25f;
+    }
+    samples.erase(samples.begin());
+
+    // Keep the samples closest to the origin, ties broken by the sampling
+    // order so that the result does not depend on the sort implementation
+    std::vector<int> order(samples.size());
+    for(size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        float la = glm::dot(samples[a], samples[a]), lb = glm::dot(samples[b], samples[b]);
+        return la < lb || (la == lb && a < b);
+    });
+    order.resize(total);
+
+    FieldRandom rng(params.seed ^ 0x9e3779b9u);
+    // shuffle, so that crystals and checkpoints are spread in the field
+    for(size_t i = order.size() - 1; i > 0; i--) {
+        std::swap(order[i], order[rng.below(i + 1)]);
+    }
+
+    Field field;
+    // asteroids never overlap, whatever maxRadius is
+    float maxRadius = std::min(params.maxRadius, params.spacing / 2.0f);
+    field.bound = 0.0f;
+    size_t next = 0;
+
+    std::vector<glm::vec3> rings;
+    for(int i = 0; i < params.checkpoints; i++) {
+        rings.push_back(samples[order[next++]]);
+    }
+    for(int i = 0; i < params.powerUps; i++) {
+        field.powerUps.push_back(samples[order[next++]]);
+    }
+    for(int i = 0; i < params.asteroids; i++) {
+        field.asteroids.push_back({
+            samples[order[next++]],
+            rng.uniform(params.minRadius, std::max(params.minRadius, maxRadius))});
+    }
+
+    // race order: always go to the closest checkpoint not yet visited
+    glm::vec3 from(0.0f);
+    while(!rings.empty()) {
+        size_t closest = 0;
+        for(size_t i = 1; i < rings.size(); i++) {
+            if(glm::distance(from, rings[i]) < glm::distance(from, rings[closest])) {
+                closest = i;
+            }
+        }
+        // rotated around one of the axes, as the hand made ones
+        glm::vec3 axis(0.0f);
+        axis[rng.below(3)] = 1.0f;
+        field.checkpoints.push_back({
+            rings[closest],
+            axis,
+            glm::radians(rng.uniform(0.0f, 90.0f))});
+        from = rings[closest];
+        rings.erase(rings.begin() + closest);
+    }
+
+    for(size_t i = 0; i < order.size(); i++) {
+        field.bound = std::max(field.bound, glm::length(samples[order[i]]));
+    }
+    field.bound += params.spacing / 2.0f;
+
+    logDebug("Generated field: %d asteroids, %d crystals, %d checkpoints, bound %.1f",
+        params.asteroids, params.powerUps, params.checkpoints, field.bound);
+    return field;
+}
@@ -0,0 +1,52 @@
+#ifndef FIELD_GENERATOR_HPP
+#define FIELD_GENERATOR_HPP
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Parameters of a procedural field, the same parameters always produce
+// the same field (no std distributions are used, their output changes
+// between standard libraries)
+struct FieldParams {
+    uint32_t seed = 1;
+    int asteroids = 15;
+    int powerUps = 9;
+    int checkpoints = 7;
+    // range of the collision radius of the asteroids
+    float minRadius = 2.0f;
+    float maxRadius = 7.0f;
+    // minimum distance between the centers of two objects, the same empty
+    // space is left around the spawn point (the origin)
+    float spacing = 24.0f;
+};
+
+// Objects of a field, in world space
+struct Field {
+    struct Sphere {
+        glm::vec3 position;
+        float radius;
+    };
+    struct Ring {
+        glm::vec3 position;
+        glm::vec3 rotation_vec;
+        float rotation_angle;   // radians
+    };
+    std::vector<Sphere> asteroids;
+    std::vector<glm::vec3> powerUps;
+    // in race order, each one is the closest to the previous
+    std::vector<Ring> checkpoints;
+    // radius of the sphere centered in the origin containing every object
+    float bound;
+};
+
+// Places the objects on a Poisson-disk sampling (Bridson) of the smallest
+// ball around the origin which fits all of them, so no two objects are
+// closer than params.spacing
+Field generateField(const FieldParams &params);
+
+// Poisson-disk sampling of the ball of the given radius centered in the
+// origin, the first sample is the origin itself
+std::vector<glm::vec3> poissonDisk(float radius, float spacing, uint32_t seed);
+
+#endif//FIELD_GENERATOR_HPP
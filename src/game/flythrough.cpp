@@ -0,0 +1,82 @@
+// Benchmark flight: the camera loops along a closed spline through the
+// checkpoints of the field, past the sun and the Earth, ignoring the input.
+// The position depends only on the frame number, so every run draws the
+// same frames whatever the speed of the machine
+#include "game_main.hpp"
+#include "log.h"
+#include <cmath>
+#include <cstdio>
+
+// Distance of the passes from the center of the sun and the Earth, in radii
+#define PASS_DISTANCE 2.5f
+// How far ahead of the camera the ship flies, in fractions of the loop
+#define SHIP_LEAD 0.002f
+
+// Point of the closed Catmull-Rom spline through the points, t in [0, 1)
+static glm::vec3 splinePoint(const std::vector<glm::vec3> &points, float t) {
+    const size_t n = points.size();
+    float s = (t - std::floor(t)) * n;
+    size_t i = std::min((size_t)s, n - 1);
+    float u = s - i;
+    const glm::vec3 &p0 = points[(i + n - 1) % n];
+    const glm::vec3 &p1 = points[i];
+    const glm::vec3 &p2 = points[(i + 1) % n];
+    const glm::vec3 &p3 = points[(i + 2) % n];
+    return 0.5f * (2.0f * p1 + (p2 - p0) * u +
+        (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u * u +
+        (3.0f * p1 - p0 - 3.0f * p2 + p3) * u * u * u);
+}
+
+// Point beside a sphere, on the side facing the origin, where the field is
+static glm::vec3 passBy(const glm::vec3 &center, float radius) {
+    glm::vec3 in = glm::length(center) > 0.0f ? -glm::normalize(center) : glm::vec3(0, 1, 0);
+    glm::vec3 axis = std::fabs(in.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 0, 1);
+    glm::vec3 side = glm::normalize(glm::cross(in, axis));
+    return center + PASS_DISTANCE * radius * glm::normalize(in + side);
+}
+
+void GameMain::initFlightPath(GameModel& game) {
+    flightPath.clear();
+    flightPath.push_back(game.character.position);
+    for(const Checkpoint &c : game.checkpoints) {
+        flightPath.push_back(c.position);
+    }
+    flightPath.push_back(passBy(game.sun.position, bounds.sphere * maxScale(USun)));
+    flightPath.push_back(passBy(game.Earth.position, bounds.sphere * maxScale(UEarth)));
+    logDebug("Benchmark: %llu frames along %zu points",
+        (unsigned long long)benchmarkFrames, flightPath.size());
+}
+
+void GameMain::flyThrough() {
+    float t = (float)frameNumber / benchmarkFrames;
+    glm::vec3 camera = splinePoint(flightPath, t);
+    glm::vec3 ahead = splinePoint(flightPath, t + SHIP_LEAD);
+    view.state.camera = camera;
+    view.state.position = ahead;
+    if(glm::length(ahead - camera) > 1e-4f) {
+        // the ship looks along -z, as the camera
+        view.state.rotation = glm::quatLookAt(glm::normalize(ahead - camera), glm::vec3(0, 1, 0));
+    }
+}
+
+void GameMain::reportBenchmark() {
+    auto line = [this](const char *name, double FrameStats::Frame::*time) {
+        FrameStats::Summary s = frameStats.summary(time);
+        if(s.count == 0) {
+            printf("%-7s not measured\n", name);
+            return;
+        }
+        printf("%-7s min %.3f  mean %.3f  p50 %.3f  p95 %.3f  p99 %.3f  max %.3f ms\n",
+            name, s.min * 1000.0, s.mean * 1000.0, s.p50 * 1000.0,
+            s.p95 * 1000.0, s.p99 * 1000.0, s.max * 1000.0);
+    };
+    printf("Frames: %zu, %s %ux%u\n", frameStats.frames().size(),
+        headless ? "headless" : "windowed", swapChainExtent.width, swapChainExtent.height);
+    line("CPU:", &FrameStats::Frame::cpu);
+    line("Fence:", &FrameStats::Frame::fence);
+    line("GPU:", &FrameStats::Frame::gpu);
+    if(!benchmarkCsv.empty()) {
+        frameStats.writeCsv(benchmarkCsv);
+        printf("Frame times: %s\n", benchmarkCsv.c_str());
+    }
+}
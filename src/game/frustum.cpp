@@ -0,0 +1,34 @@
+#include "frustum.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Gribb-Hartmann: each plane is a sum or difference of the rows of the
+// matrix, glm stores the columns so row i is (M[0][i], M[1][i], ...)
+Frustum::Frustum(const glm::mat4 &ViewPrj) {
+    glm::mat4 T = glm::transpose(ViewPrj);
+    planes[0] = T[3] + T[0];    // left
+    planes[1] = T[3] - T[0];    // right
+    planes[2] = T[3] + T[1];    // bottom (top once y is flipped)
+    planes[3] = T[3] - T[1];
+    planes[4] = T[2];           // near, depth in [0, 1]
+    planes[5] = T[3] - T[2];    // far
+    for(glm::vec4 &p : planes) {
+        p /= glm::length(glm::vec3(p));
+    }
+}
+
+bool Frustum::sphere(glm::vec3 center, float radius) const {
+    for(const glm::vec4 &p : planes) {
+        if(glm::dot(glm::vec3(p), center) + p.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+float maxScale(const glm::mat4 &M) {
+    return std::sqrt(std::max({
+        glm::dot(glm::vec3(M[0]), glm::vec3(M[0])),
+        glm::dot(glm::vec3(M[1]), glm::vec3(M[1])),
+        glm::dot(glm::vec3(M[2]), glm::vec3(M[2]))}));
+}
@@ -0,0 +1,25 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+// The six planes of a view frustum in world space, extracted from a view
+// projection matrix with depth in [0, 1] (GLM_FORCE_DEPTH_ZERO_TO_ONE).
+// Each plane points inside: dot(plane.xyz, p) + plane.w >= 0 for the
+// points p on the visible side.
+class Frustum {
+    glm::vec4 planes[6];
+public:
+    Frustum() = default;
+    Frustum(const glm::mat4 &ViewPrj);
+    // false only if the sphere is completely outside, spheres near the
+    // corners may be kept even if they are not visible
+    bool sphere(glm::vec3 center, float radius) const;
+    // left, right, bottom, top, near, far
+    inline const glm::vec4& plane(int i) const { return planes[i]; }
+};
+
+// Largest scale factor of the axes of a model matrix
+float maxScale(const glm::mat4 &M);
+
+#endif//FRUSTUM_HPP
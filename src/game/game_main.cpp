@@ -1,10 +1,7 @@
 #include "game_main.hpp"
 #include "log.h"
-
-// update this for every element you add
-#define UNIFORM_BLOCKS_IN_POOL  60
-#define TEXTURES_IN_POOL        60
-#define SETS_IN_POOL            60
+#include <algorithm>
+#include <cinttypes>
 
 // No need to change this
 std::ostream& operator<<(std::ostream& stream, glm::vec3& vec) {
@@ -19,11 +16,13 @@ void GameMain::setWindowParameters() {
     windowResizable = GLFW_TRUE;
     initialBackgroundColor = {0.0f, 0.005f, 0.01f, 1.0f};
     
-    // Descriptor pool sizes
-    uniformBlocksInPool =  UNIFORM_BLOCKS_IN_POOL;
-    texturesInPool =  TEXTURES_IN_POOL;
-    setsInPool = SETS_IN_POOL;
-    /* Update the requirements for the size of the pool */
+    // Record each group of draw calls on its own thread
+    parallelRecording = true;
+    // The draw calls depend on what is in view
+    recordEveryFrame = true;
+
+    // Descriptor pool sizes are computed from the DescriptorSet::init calls,
+    // no need to update them when adding elements
     //here we dinamically set the aspect ratio
     Ar = (float)windowWidth / (float)windowHeight;
 }
@@ -36,17 +35,50 @@ void GameMain::onWindowResize(int w, int h) {
 
 // No need to change this
 void GameMain::updateUniformBuffer(uint32_t currentImage) {
-    static GameModel game;
     //if we press escape we closw the window
-    if(glfwGetKey(window, GLFW_KEY_ESCAPE)) {
+    if(!headless && glfwGetKey(window, GLFW_KEY_ESCAPE)) {
 		glfwSetWindowShouldClose(window, GL_TRUE);
 	}
+    // headless stops by itself after headlessFrames
+    if(!headless && benchmarkFrames && frameNumber + 1 >= benchmarkFrames) {
+        glfwSetWindowShouldClose(window, GL_TRUE);
+    }
 
     // get input from sixaxis
-    gameLogic(game);
+    gameLogic(*game);
     // game logic
 
-    drawScreen(game, currentImage);
+    long second = (long)view.state.time;
+    logStats = second != logSecond;
+    logSecond = second;
+
+    cullScene(*game);
+    sortDraws(*game, currentImage);
+    assignLights(*game);
+
+    drawScreen(*game, currentImage);
 
     // draw screen
+    if(logStats) {
+        logGpuStats();
+    }
+}
+
+// Results of the queries read back by drawFrame, of the last frame which
+// used the image
+void GameMain::logGpuStats() {
+    if(fragmentStatistics) {
+        logDebug("Fragments: %" PRIu64 " shaded by the last frame", fragmentInvocations);
+    }
+    if(dynamicResolution) {
+        float lo = resolution.maxScale, hi = resolution.minScale;
+        for(const ResolutionController::Sample &s : resolution.history()) {
+            lo = std::min(lo, s.scale);
+            hi = std::max(hi, s.scale);
+        }
+        logDebug("Resolution: scale %.2f (%.2f to %.2f in the last %zu frames), GPU %.2f ms",
+            resolution.scale(), lo, hi, resolution.history().size(), gpuFrameTime * 1000.0);
+    } else if(gpuTiming) {
+        logDebug("GPU: %.2f ms", gpuFrameTime * 1000.0);
+    }
 }
\ No newline at end of file
@@ -4,18 +4,179 @@
 #include "vulkan/vulkan_core.h"
 #include <project_setup.hpp>
 #include <data_types.hpp>
+#include <triple_buffer.hpp>
+#include <render_queue.hpp>
 #include "game_model.hpp"
+#include "frustum.hpp"
 
+#include <array>
+#include <atomic>
 #include <iostream>
-//number of asteroids, checkpoints and powerups
-#define ASTEROIDS   15
-#define CHECKPOINTS 7
-#define POWERUPS    9
+#include <string>
+#include <thread>
+#include <vector>
+
+// Asteroid models are scaled by this times their collider radius, then by
+// Uast
+#define ASTEROID_SCALE 1.2f
+// Side of the first level of the depth pyramid of the occlusion culling, a
+// power of two
+#define HIZ_SIZE 256
+// Asteroids further than this from the camera are drawn without normal map
+// (only when sorted front to back, on the CPU)
+#define NORMAL_MAP_DISTANCE 60.0f
+// Froxel grid of the clustered lighting, see src/game/lights.cpp
+#define CLUSTER_TILES_X 16
+#define CLUSTER_TILES_Y 9
+#define CLUSTER_SLICES 24
+#define CLUSTER_COUNT (CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES)
+// Light indices of all the froxels, the lights past it are dropped
+#define CLUSTER_INDEX_CAPACITY (CLUSTER_COUNT * 8)
+// Reach of the light orbiting each crystal
+#define CRYSTAL_LIGHT_RANGE 12.0f
+// Command buffers the sorted draws are split in with parallel recording, at
+// most, each with at least GROUP_DRAWS draws: each one binds its state again
+#define RECORD_GROUPS 8
+#define GROUP_DRAWS 64
 
 std::ostream& operator<<(std::ostream& stream, glm::vec3& vec);
 
 class GameMain : public BaseProject {
+public:
+    // Play on a procedural field instead of the hand made race
+    bool proceduralField = false;
+    FieldParams field;
+    // Simulation steps per second, independent from the frame rate
+    float tickRate = 120.0f;
+    // Run the simulation on its own thread, otherwise the ticks are run by
+    // the render thread before drawing each frame
+    bool simulationThread = true;
+    // Cull the asteroid field with a compute shader and draw it with an
+    // indirect draw, the CPU does not touch the single asteroids
+    bool gpuCulling = false;
+    // Also skip the asteroids hidden by the sun or the Earth, tested against
+    // a depth pyramid of the two spheres built on the GPU (needs gpuCulling)
+    bool occlusionCulling = false;
+    // Read back the counters of the GPU culling to log them, otherwise the
+    // CPU never reads the buffers written by the culling shader
+    bool cullingStatistics = false;
+    // Draw the opaque objects front to back and the universe after them,
+    // otherwise the universe first and the others in the order of the
+    // render queue
+    bool frontToBack = true;
+    // Cheaper shading: no specular highlights and no normal map on the
+    // asteroids, selected with specialization constants
+    bool lowQualityShading = false;
+    // Benchmark: for this many frames the camera flies along a fixed path
+    // whatever the input, then the window closes (see
+    // src/game/flythrough.cpp). 0 to play
+    uint64_t benchmarkFrames = 0;
+    // Times of each frame of the benchmark, if not empty
+    std::string benchmarkCsv;
+
+    // Distribution of the frame times of the benchmark, after run()
+    void reportBenchmark();
+
 protected:
+    // Created in localInit, the number of descriptor sets depends on it
+    GameModel *game = nullptr;
+    // Time not simulated yet, less than a tick (without simulation thread)
+    float tickAccumulator = 0.0f;
+
+    // The simulation thread owns the game model, it receives the latest
+    // input and publishes a snapshot after each tick. Both sides never wait
+    // for each other, see src/game/simulation.cpp
+    std::thread simulationWorker;
+    std::atomic<bool> simulationRunning{false};
+    TripleBuffer<ControlInput> inputs;
+    TripleBuffer<GameSnapshot> snapshots;
+
+    // What the current frame draws, built by gameLogic from the latest
+    // snapshot
+    struct FrameView {
+        RenderState state;
+        int checkpoint;
+        bool boost;
+        glm::mat4 ViewPrj, fixed_ViewPrj, World;
+        float nearPlane, farPlane;
+    } view;
+
+    // Frustum culling, see src/game/culling.cpp
+    // Radius of the bounding sphere of the models around their origin,
+    // computed from the vertices
+    struct ModelBounds {
+        float asteroid, crystal, torus, sphere, ship;
+        // largest sphere inside the sphere model, for the occluders
+        float sphereInner;
+    } bounds;
+    // What survives the culling of the current frame, the uniforms are
+    // updated and the draw calls recorded only for these objects
+    struct Visibility {
+        Frustum frustum;
+        std::vector<uint32_t> asteroids, crystals;
+        bool sun = false, earth = false, checkpoint = false;
+        // objects tested this frame (on the CPU)
+        size_t visible = 0, culled = 0;
+        // asteroids drawn by the last frame which used this image, with
+        // the GPU culling and cullingStatistics, of the ones in the frustum,
+        // and of these the ones rejected by the depth pyramid
+        uint32_t gpuAsteroids = 0, gpuInFrustum = 0, gpuOccluded = 0;
+        // in the frustum but hidden by the sun or the Earth, with
+        // occlusionCulling
+        size_t occludedCrystals = 0;
+        // the first ones of asteroids, closer than NORMAL_MAP_DISTANCE
+        size_t nearAsteroids = 0;
+    } visibility;
+
+    // Set by updateUniformBuffer once a second of game time, the culling,
+    // the lights, the render queue and the GPU queries then log what they
+    // produced
+    bool logStats = false;
+    long logSecond = -1;
+
+    // Lights of the current frame and the froxels they reach, built by
+    // assignLights
+    struct LightClusters {
+        // the lights which touch the frustum
+        std::vector<PointLight> lights;
+        // offset in indices and number of lights of each froxel, x first,
+        // then y, then the slice
+        std::vector<glm::uvec2> ranges;
+        std::vector<uint32_t> indices;
+        // light and froxel pairs over CLUSTER_INDEX_CAPACITY, most lights
+        // in a froxel
+        size_t dropped = 0;
+        uint32_t maxPerCluster = 0;
+    } clusters;
+
+    // Passes of the render queue, drawn in this order
+    enum DrawPass {
+        SKY_FIRST_PASS,     // the universe, without frontToBack
+        OPAQUE_PASS,
+        SKY_LAST_PASS,      // the universe, with frontToBack
+        OVERLAY_PASS        // the HUD, after the upscale with dynamicResolution
+    };
+    // Draws of the current frame, sorted by state, see
+    // src/game/draw_order.cpp
+    RenderQueue renderQueue;
+    // Binds of the last frame recorded, one for each group, the last one
+    // for the overlay
+    std::array<RenderQueue::Stats, RECORD_GROUPS + 1> recordStats;
+
+    // Control points of the benchmark flight, a closed loop
+    std::vector<glm::vec3> flightPath;
+
+    // Specialization constants of Mesh.frag, Earth.frag and Asteroids.frag,
+    // the constant_id in the shaders
+    enum ShadingConstant {
+        LIGHT_BETA,
+        LIGHT_G,
+        SPECULAR_POWER,
+        AMBIENT_SCALE,
+        NORMAL_MAPPING,
+        SPECULAR
+    };
+
     // Used to sotre Aspect ratio
     float Ar;
 
@@ -38,7 +199,6 @@ protected:
         VAsteroids,
         VEarth,
         VTorus,
-        VUV,
         VNorm,
         VNormUV,
         VNormTanUV,
@@ -48,14 +208,28 @@ protected:
 
     // Create a new custom pipeline
     Pipeline
-        PPlain,
+        PSkybox,
         PMesh,
         PTorus,
         PAsteroids,
+        // the distant asteroids, same shaders without normal map
+        PAsteroidsFar,
         PSun,
         PEarth,
         PCrystal,
         PText;
+    // Asteroid field culling, with gpuCulling, and the depth pyramid of the
+    // occlusion culling
+    ComputePipeline
+        PCullAsteroids,
+        PHiZOccluders,
+        PHiZDownsample;
+    // Written by CullAsteroids.comp, the draw command followed by counters
+    struct AsteroidDraw {
+        VkDrawIndexedIndirectCommand draw;
+        uint32_t inFrustum;
+        uint32_t occluded;
+    };
 
     // Objects to keep model data, be sure to use the proper
     // Vertex descriptor (the one which match the model
@@ -63,7 +237,6 @@ protected:
     // You can check them in
     // src/lib/data_types.hpp
     Model<VertexUV>
-        MUniverse,
         MSun; 
     Model<VertexNormUV>
         MMesh;
@@ -80,8 +253,6 @@ protected:
         MBoost;
 
     // Objects to keep texture data
-    // When creating a new one, be sure to update
-    // src/game/game_main.cpp:6
     Texture
         TUniverse,
         TMesh,
@@ -96,8 +267,6 @@ protected:
         TBoost;
     
     // Create a new descriptor set for your pipeline
-    // Remember to update
-    // src/game/game_main.cpp:7
     DescriptorSet
         DSSunLight,
         DSSun,
@@ -105,11 +274,14 @@ protected:
         DSUniverse,
         DSMesh,
         DSTorus,
-        DSAsteroids[ASTEROIDS],
-        DSCrystal[POWERUPS],
+        // The whole field is drawn with a single instanced draw call, the
+        // matrices of the asteroids are in a storage buffer
+        DSAsteroids,
         DSText,
         DSPToonLight,
         DSBoost;
+    // One for each crystal
+    std::vector<DescriptorSet> DSCrystal;
 
     // Uniform Blocks Objects are data passed to the GPU
     // Create a new object to pass data to the GPU
@@ -119,13 +291,16 @@ protected:
 
     // UBO for sun pointlight
     GlobalUniformBlockPointLight
-        guboPLSun,
-        guboPLCrystal;
+        guboPLSun;
+
+    // The light list is in the storage buffers of DSPToonLight
+    ClusterUniformBlock uboClusters;
     
     // UBO for elements whiich only need a model and a texture
     PlainUniformBlock
-        uboSun,
-        uboUniverse;
+        uboSun;
+
+    SkyboxUniformBlock uboUniverse;
     
     // UBO for meshes (elements which interact with light)
     MeshUniformBlock
@@ -137,6 +312,11 @@ protected:
     TextUniformBlock
         uboText,
         uboBoost;
+
+    CullUniformBlock uboCull;
+
+    // One for each asteroid, copied in the storage buffer of DSAsteroids
+    std::vector<MeshUniformBlock> uboAsteroids;
     // Define matrices statically used by the program
     // EG: matricess to properly scale the sun or the universe
     // You can initialize them at
@@ -146,22 +326,41 @@ protected:
         USun, //for the sun scaling
         UEarth, //for the planet Earth scaling  
         Uast,
-        UGWM;
+        UCrystal;
 
     void setWindowParameters();
     void onWindowResize(int w, int h);
 
     void localInit();
     void pipelinesAndDescriptorSetsInit();
+    void specializeShading(Pipeline &P, bool normalMapping);
     void pipelinesAndDescriptorSetsCleanup();
     void localCleanup();
     void populateCommandBuffer(VkCommandBuffer commandBuffer, int currentImage);
+    void populateComputeCommands(VkCommandBuffer commandBuffer, int currentImage);
+    void populateFinalCommands(VkCommandBuffer commandBuffer, int currentImage);
+    int commandGroups();
+    void populateCommandGroup(VkCommandBuffer commandBuffer, int currentImage, int group);
+    void populateOverlayCommands(VkCommandBuffer commandBuffer, int currentImage);
 
     void updateUniformBuffer(uint32_t currentImage);
 
     void gameLogic(GameModel& game);
 
+    void startSimulation();
+    void stopSimulation();
+    void stepSimulation(const ControlInput &input);
+    void simulationLoop();
+
+    void initBounds();
+    void cullScene(GameModel& game);
+    void sortDraws(GameModel& game, uint32_t currentImage);
+    size_t sceneDraws();
+    void assignLights(GameModel& game);
+    void initFlightPath(GameModel& game);
+    void flyThrough();
     void drawScreen(GameModel& game, uint32_t currentImage);
+    void logGpuStats();
 };
 
 #endif//GAME_MAIN_HPP
\ No newline at end of file
@@ -1,7 +1,6 @@
 #include "game_model.hpp"
-#include "game_main.hpp"
+#include "field_generator.hpp"
 #include "log.h"
-#include "vulkan/vulkan_core.h"
 
 // For each asteroid
 //      Position (x,y,z)
@@ -96,16 +95,13 @@ float C[] = {
     0, 1, 0,
     45
 };
-//here we initialize all the objects that we will use in our game
+//here we initialize all the objects that we will use in our game,
+//with the hand made race defined above
 GameModel::GameModel() {
-    character = new SpaceShip(glm::vec3(0,0,0), 0.5);
-    camera = new GenericObject(glm::vec3(0,0,0));
-    //here we create an object related to the position of the Sun and Earth
-    sun = new GenericObject(glm::vec3(0,-89,0));
-    Earth = new GenericObject(glm::vec3(-35,78,-25));
+    init(68.0f);
     logDebug("Initializing asteroids");
     //in this cycle i assign the positions and scaling to each asteroid 
-    for (int i = 0; i< 4 * ASTEROIDS; i+=4) {
+    for (size_t i = 0; i < sizeof(A) / sizeof(*A); i+=4) {
         asteroids.push_back(Asteroid(
             glm::vec3(
                 A[i],
@@ -116,7 +112,7 @@ GameModel::GameModel() {
 
     logDebug("Initializing powerups");
     //in this cycle i assign the positions to each powerup crystal 
-    for (int i = 0; i< 3 * POWERUPS; i+=3) {
+    for (size_t i = 0; i < sizeof(P) / sizeof(*P); i+=3) {
         powerUps.push_back(PowerUp(
                 glm::vec3(
                     P[i],
@@ -125,7 +121,7 @@ GameModel::GameModel() {
     }
     logDebug("Initializing checkpoints");
     //in this cycle i assign the positions, rotation angles and rotation vectors of the checkpoints
-    for (int i = 0; i< 7 * CHECKPOINTS; i+=7) {
+    for (size_t i = 0; i < sizeof(C) / sizeof(*C); i+=7) {
         checkpoints.push_back(Checkpoint(
             glm::vec3(
                 C[i],
@@ -138,15 +134,58 @@ GameModel::GameModel() {
             glm::radians(C[i+6])));
     }
 
+    initBroadPhase();
     logDebug("Created GameModel");
 }
 
+//here we build a procedural field, see field_generator.hpp
+GameModel::GameModel(const FieldParams &params) {
+    Field field = generateField(params);
+    init(field.bound);
+
+    for(Field::Sphere &el : field.asteroids) {
+        asteroids.push_back(Asteroid(el.position, el.radius));
+    }
+    for(glm::vec3 &el : field.powerUps) {
+        powerUps.push_back(PowerUp(el));
+    }
+    for(Field::Ring &el : field.checkpoints) {
+        checkpoints.push_back(Checkpoint(el.position, el.rotation_vec, el.rotation_angle));
+    }
+
+    initBroadPhase();
+    logDebug("Created GameModel (seed %u)", params.seed);
+}
+
+void GameModel::init(float bound) {
+    //the hand made race fits in 68 units, bigger fields push the sky,
+    //the sun and the Earth further away
+    float scale = glm::max(1.0f, bound / 68.0f);
+    this->bound = bound;
+    skyRadius = 100.0f * scale;
+
+    character = SpaceShip(glm::vec3(0,0,0), 0.5);
+    camera = GenericObject(glm::vec3(0,0,0));
+    //here we create an object related to the position of the Sun and Earth
+    sun = GenericObject(glm::vec3(0,-89,0) * scale);
+    Earth = GenericObject(glm::vec3(-35,78,-25) * scale);
+}
+
+void GameModel::initBroadPhase() {
+    asteroidStore.reserve(asteroids.size());
+    powerUpStore.reserve(powerUps.size());
+    for(Asteroid &el : asteroids) {
+        asteroidGrid.insertStatic(el.position, el.radius);
+        asteroidStore.add(el.position, el.radius);
+    }
+    for(PowerUp &el : powerUps) {
+        powerUpGrid.insertStatic(el.position, el.radius);
+        powerUpStore.add(el.position, el.radius);
+    }
+}
+
 GameModel::~GameModel() {
     logDebug("Destroyed GameModel");
-    delete character;
-    delete camera;
-    delete sun;
-    delete Earth;
 }
 //generic position object
 GenericObject::GenericObject(glm::vec3 position) {
@@ -158,9 +197,11 @@ ColliderObject::ColliderObject(glm::vec3 position, float radius) {
     this->radius = radius;
 }
 //here we return 1 if the distance between our object and other objects is less than a certain amount
+//compare the squared distance to avoid the square root
 bool ColliderObject::collision(ColliderObject& other) {
-    return glm::distance(this->position, other.position)
-        < (this->radius + other.radius);
+    glm::vec3 d = this->position - other.position;
+    float r = this->radius + other.radius;
+    return glm::dot(d, d) < r * r;
 }
 
 SpaceShip::SpaceShip(glm::vec3 position, float radius): ColliderObject(position, radius) {
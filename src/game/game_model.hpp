@@ -2,38 +2,17 @@
 #define GAME_MODEL_HPP
 
 #include "glm/detail/qualifier.hpp"
+#include <chrono>
 #include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
+#include "spatial_grid.hpp"
+#include "collider_store.hpp"
+#include "field_generator.hpp"
 
-class GenericObject;
-
-class ColliderObject;
-class SpaceShip;
-class Asteroid;
-class Checkpoint;
-class PowerUp;
-
-class GameModel {
-    int current_checkpoint;
-public:
-    float time;
-    glm::mat4 fixed_ViewPrj,ViewPrj, World;
-    SpaceShip* character;
-    GenericObject *camera, *sun,  *Earth;
-    std::vector<Asteroid> asteroids;
-    std::vector<Checkpoint> checkpoints;
-    std::vector<PowerUp> powerUps;
-    bool collision();
-    bool on_crystal();
-    bool race_check();
-    bool race_make_next();
-    inline int curr_check() { return current_checkpoint; }
-    GameModel();
-    ~GameModel();
-    bool visiblecommands=true;
-    // Define here all the variables for the game model
-};
+// Up to this many colliders a SIMD scan of all of them is faster than the
+// grid (see bench/collision_bench.cpp)
+#define BROAD_PHASE_THRESHOLD 64
 
 class GenericObject {
 public:
@@ -71,4 +50,115 @@ public:
     PowerUp(glm::vec3 position);
 };
 
+// What the renderer needs from a tick of the simulation, frames are drawn
+// between the last two ticks
+struct RenderState {
+    float time;
+    glm::vec3 position;     // of the character
+    glm::quat rotation;     // of the character
+    glm::vec3 camera;
+    float FOVy;
+};
+
+// State of the controllers, see BaseProject::getSixAxis
+struct ControlInput {
+    glm::vec3 m = glm::vec3(0.0f);
+    glm::vec3 r = glm::vec3(0.0f);
+    bool fire = false;
+};
+
+// Immutable copy of the dynamic part of a GameModel taken after a tick, the
+// static objects (asteroids, crystals, checkpoints, sun and Earth) never
+// change and are read directly from the model
+struct GameSnapshot {
+    unsigned long ticks = 0;
+    RenderState previous, current;
+    int checkpoint = 0;
+    bool boost = false;
+    // when the tick was published, to interpolate the following frames
+    std::chrono::steady_clock::time_point published;
+
+    // alpha = 0 is the previous tick, alpha = 1 the current one
+    RenderState interpolate(float alpha) const;
+};
+
+// Value smoothed over the ticks, see tick.cpp
+template <class T>
+struct Damped {
+    T value;
+    bool primed = false;
+    T operator()(T newVal, float lambda, float dt);
+};
+
+// What a tick leaves to the next one, besides the objects: everything
+// belongs to a GameModel, so any number of them can be stepped at once
+struct TickState {
+    bool is_on_crystal = false;
+    bool is_checkpoint = false;
+    float boost_time = 0.0f;
+    float checkpoint_delay = 0.0f;
+    float Momentum = 0.0f;
+    Damped<float> MOVE_SPEEDOld, FOVyOld;
+    Damped<glm::vec3> cameraPositionOld;
+};
+
+// Progress of a race, for the batch simulator
+struct RaceStats {
+    int checkpoints = 0;    // reached so far
+    int laps = 0;
+    float lapTime = 0.0f;   // game time when the first lap was completed
+    int bounces = 0;        // against asteroids and the field bound
+    int powerUps = 0;
+};
+
+class GameModel {
+    int current_checkpoint = 0;
+    TickState tickState;
+    // Broad phase for the collisions with asteroids and power ups, the ids
+    // in the grids and stores are the indices in the vectors below
+    SpatialGrid asteroidGrid, powerUpGrid;
+    ColliderStore asteroidStore, powerUpStore;
+    std::vector<int> asteroidHits, powerUpHits;
+
+    // Objects which do not depend on the field
+    void init(float bound);
+    void initBroadPhase();
+public:
+    float time = 0.0f;
+    // Simulation steps done so far
+    unsigned long ticks = 0;
+    // State after the last two ticks
+    RenderState previous, current;
+    // Boost available (to show its icon)
+    bool boost = false;
+    RaceStats stats;
+    // The character can not go further than bound from the origin, the
+    // universe sphere has radius skyRadius
+    float bound, skyRadius;
+    // Placed by init, a copy of the model is an independent race on the
+    // same field
+    SpaceShip character{glm::vec3(0.0f), 0.5f};
+    GenericObject camera{glm::vec3(0.0f)}, sun{glm::vec3(0.0f)}, Earth{glm::vec3(0.0f)};
+    std::vector<Asteroid> asteroids;
+    std::vector<Checkpoint> checkpoints;
+    std::vector<PowerUp> powerUps;
+    // Indices of the asteroids/power ups touched by the character
+    const std::vector<int>& collision();
+    const std::vector<int>& on_crystal();
+    bool race_check();
+    bool race_make_next();
+    inline int curr_check() { return current_checkpoint; }
+    // Advance the simulation by a tick, see tick.cpp
+    void step(float deltaT, const ControlInput &input);
+    // FNV-1a of the dynamic state, equal on every run with the same field,
+    // tick rate and inputs
+    uint64_t hash() const;
+    // The hand made race
+    GameModel();
+    // A procedural field
+    GameModel(const FieldParams &params);
+    ~GameModel();
+    // Define here all the variables for the game model
+};
+
 #endif//GAME_MODEL_HPP
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "input_script.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+void InputScript::load(const std::string &file) {
+    std::ifstream in(file);
+    if(!in) {
+        throw std::runtime_error("Unable to open script " + file);
+    }
+    lines.clear();
+    std::string text;
+    for(int number = 1; std::getline(in, text); number++) {
+        text = text.substr(0, text.find('#'));
+        if(text.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        std::istringstream values(text);
+        Line l;
+        int fire;
+        if(!(values >> l.ticks
+                >> l.input.m.x >> l.input.m.y >> l.input.m.z
+                >> l.input.r.x >> l.input.r.y >> l.input.r.z
+                >> fire)) {
+            throw std::runtime_error(file + ":" + std::to_string(number) + ": invalid input");
+        }
+        l.input.fire = fire != 0;
+        lines.push_back(l);
+    }
+}
+
+ScriptPlayer::ScriptPlayer(const InputScript &script): script(&script) {
+    left = script.lines.empty() ? 0 : script.lines[0].ticks;
+}
+
+const ControlInput& ScriptPlayer::next() {
+    const std::vector<InputScript::Line> &lines = script->lines;
+    while(line < lines.size() && left == 0) {
+        if(++line < lines.size()) {
+            left = lines[line].ticks;
+        }
+    }
+    if(line >= lines.size()) {
+        return idle;
+    }
+    left--;
+    return lines[line].input;
+}
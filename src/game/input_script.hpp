@@ -0,0 +1,34 @@
+#ifndef INPUT_SCRIPT_HPP
+#define INPUT_SCRIPT_HPP
+
+#include <string>
+#include <vector>
+#include "game_model.hpp"
+
+// Text file of inputs for the offline runs, one line per input:
+//      <ticks> <m.x> <m.y> <m.z> <r.x> <r.y> <r.z> <fire>
+// holding that input for the given number of ticks, '#' starts a comment
+struct InputScript {
+    struct Line {
+        unsigned long ticks;
+        ControlInput input;
+    };
+    std::vector<Line> lines;
+
+    // throws if the file can not be read or a line is invalid
+    void load(const std::string &file);
+};
+
+// Plays an InputScript tick by tick, the input is zero after the last line.
+// Any number of players can share a script.
+class ScriptPlayer {
+    const InputScript *script;
+    size_t line = 0;
+    unsigned long left;
+    ControlInput idle;
+public:
+    ScriptPlayer(const InputScript &script);
+    const ControlInput& next();
+};
+
+#endif//INPUT_SCRIPT_HPP
@@ -0,0 +1,123 @@
+// Clustered lighting of the crystals: each one has a point light orbiting
+// around it, all of them go in a light list. The frustum is split in a grid
+// of froxels, screen tiles times depth slices, and every froxel gets the
+// indices of the lights which reach it. Crystal.frag and Mesh.frag find the
+// froxel of the fragment and only loop over its lights, so their cost
+// depends on the lights nearby and not on all the lights of the field
+#include "game_main.hpp"
+#include "log.h"
+#include <algorithm>
+#include <cmath>
+
+// Froxels covered by a light, first and last of each axis
+struct ClusterBox {
+    uint32_t x0, y0, z0, x1, y1, z1;
+};
+
+// Tile of a coordinate in [-1, 1]
+static uint32_t tile(float ndc, int tiles) {
+    return static_cast<uint32_t>(glm::clamp((int)std::floor((ndc * 0.5f + 0.5f) * tiles), 0, tiles - 1));
+}
+
+void GameMain::assignLights(GameModel& game) {
+    LightClusters &c = clusters;
+
+    // the same grid is rebuilt by the shaders from this
+    uboClusters.viewPrj = view.ViewPrj;
+    uboClusters.eyePos = glm::vec4(view.state.camera, 1.0f);
+    uboClusters.sliceScale = CLUSTER_SLICES / std::log(view.farPlane / view.nearPlane);
+    uboClusters.sliceBias = -std::log(view.nearPlane) * uboClusters.sliceScale;
+    uboClusters.tilesX = CLUSTER_TILES_X;
+    uboClusters.tilesY = CLUSTER_TILES_Y;
+    uboClusters.slices = CLUSTER_SLICES;
+    auto slice = [&](float depth) {
+        depth = std::max(depth, view.nearPlane);
+        int z = (int)std::floor(std::log(depth) * uboClusters.sliceScale + uboClusters.sliceBias);
+        return static_cast<uint32_t>(glm::clamp(z, 0, CLUSTER_SLICES - 1));
+    };
+
+    c.lights.clear();
+    std::vector<ClusterBox> boxes;
+    for(const PowerUp &p : game.powerUps) {
+        PointLight light;
+        light.position = glm::vec4(p.position + glm::vec3(
+            glm::cos(glm::radians(40.0f) * view.state.time),
+            glm::sin(glm::radians(40.0f) * view.state.time),
+            0), CRYSTAL_LIGHT_RANGE);
+        light.color = glm::vec4(5.0f, 5.0f, 5.0f, 3.0f);
+        glm::vec3 center(light.position);
+        if(!visibility.frustum.sphere(center, CRYSTAL_LIGHT_RANGE)) {
+            continue;
+        }
+
+        // depth is the distance along the view direction
+        float depth = (view.ViewPrj * glm::vec4(center, 1.0f)).w;
+        ClusterBox b{0, 0, slice(depth - CRYSTAL_LIGHT_RANGE),
+            CLUSTER_TILES_X - 1, CLUSTER_TILES_Y - 1, slice(depth + CRYSTAL_LIGHT_RANGE)};
+        // screen rectangle of the box around the sphere, the whole screen
+        // if it crosses the near plane
+        glm::vec2 lo(1.0f), hi(-1.0f);
+        bool inFront = true;
+        for(int i = 0; i < 8 && inFront; i++) {
+            glm::vec3 corner = center + CRYSTAL_LIGHT_RANGE * glm::vec3(
+                (i & 1) ? 1.0f : -1.0f,
+                (i & 2) ? 1.0f : -1.0f,
+                (i & 4) ? 1.0f : -1.0f);
+            glm::vec4 clip = view.ViewPrj * glm::vec4(corner, 1.0f);
+            inFront = clip.w > view.nearPlane;
+            lo = glm::min(lo, glm::vec2(clip) / clip.w);
+            hi = glm::max(hi, glm::vec2(clip) / clip.w);
+        }
+        if(inFront) {
+            b.x0 = tile(lo.x, CLUSTER_TILES_X);
+            b.y0 = tile(lo.y, CLUSTER_TILES_Y);
+            b.x1 = tile(hi.x, CLUSTER_TILES_X);
+            b.y1 = tile(hi.y, CLUSTER_TILES_Y);
+        }
+        c.lights.push_back(light);
+        boxes.push_back(b);
+    }
+
+    // count the lights of each froxel, then give each froxel its slice of
+    // indices and fill it: no list per froxel
+    auto forEachCluster = [](const ClusterBox &b, auto f) {
+        for(uint32_t z = b.z0; z <= b.z1; z++) {
+            for(uint32_t y = b.y0; y <= b.y1; y++) {
+                for(uint32_t x = b.x0; x <= b.x1; x++) {
+                    f((z * CLUSTER_TILES_Y + y) * CLUSTER_TILES_X + x);
+                }
+            }
+        }
+    };
+    c.ranges.assign(CLUSTER_COUNT, glm::uvec2(0));
+    for(const ClusterBox &b : boxes) {
+        forEachCluster(b, [&](uint32_t k) { c.ranges[k].y++; });
+    }
+    uint32_t offset = 0;
+    size_t total = 0;
+    c.maxPerCluster = 0;
+    for(glm::uvec2 &r : c.ranges) {
+        total += r.y;
+        c.maxPerCluster = std::max(c.maxPerCluster, r.y);
+        // the froxels past the capacity lose their lights
+        r.y = std::min<uint32_t>(r.y, CLUSTER_INDEX_CAPACITY - offset);
+        r.x = offset;
+        offset += r.y;
+    }
+    c.dropped = total - offset;
+    c.indices.resize(offset);
+    std::vector<uint32_t> filled(CLUSTER_COUNT, 0);
+    for(uint32_t l = 0; l < boxes.size(); l++) {
+        forEachCluster(boxes[l], [&](uint32_t k) {
+            if(filled[k] < c.ranges[k].y) {
+                c.indices[c.ranges[k].x + filled[k]++] = l;
+            }
+        });
+    }
+
+    if(logStats) {
+        logDebug("Lights: %zu in view, %.2f per froxel (at most %u, %zu dropped)",
+            c.lights.size(), (double)c.indices.size() / CLUSTER_COUNT,
+            c.maxPerCluster, c.dropped);
+    }
+}
@@ -6,6 +6,11 @@
 #include <cstddef>
 
 void GameMain::localInit() {
+    // The number of objects in the scene is known only once the model is built
+    game = proceduralField ? new GameModel(field) : new GameModel();
+    uboAsteroids.resize(game->asteroids.size());
+    DSCrystal.resize(game->powerUps.size());
+
     // Initialize the Descriptor Set Layout
     // Specifying the elements passed to the GPU
     // For each binding you plan to use in the associated set
@@ -25,11 +30,21 @@ void GameMain::localInit() {
         {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT}
     });
 
-    DSLAsteroids.init(this, {
-        {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT},
+    std::vector<DescriptorSetLayoutBinding> asteroidBindings = {
+        {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT},
         {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
         {2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT}
-    });
+    };
+    if(gpuCulling) {
+        // Bindings 3 to 6 are only used by the GPU culling, which fills 0
+        asteroidBindings.insert(asteroidBindings.end(), {
+            {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+            {4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+            {5, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+            {6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT}
+        });
+    }
+    DSLAsteroids.init(this, asteroidBindings);
 
     DSLSun.init(this, {
         {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT}
@@ -45,9 +60,14 @@ void GameMain::localInit() {
         {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT}
     });
 
+    // The froxel grid, the toon ramp of the crystals, the light list, the
+    // ranges of the froxels and their light indices
     DSLPToonLight.init(this, {
         {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT},
-        {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT}
+        {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
+        {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT},
+        {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT},
+        {4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT}
     });
 
     DSLCrystal.init(this, {
@@ -73,14 +93,8 @@ void GameMain::localInit() {
     //      4. Offset of the element in the data structure
     //      5. Size in byte of the data structure to map
     //      6. Define element usage (used by vulkan to retrieve data)
-    VUV.init(this, {
-        {0, sizeof(VertexUV), VK_VERTEX_INPUT_RATE_VERTEX}
-    }, {
-        {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(VertexUV, pos),
-            sizeof(glm::vec3), POSITION},
-        {0, 1, VK_FORMAT_R32G32_SFLOAT, offsetof(VertexUV, UV),
-            sizeof(glm::vec2), UV}
-    });
+    // The skybox is a fullscreen triangle built in the vertex shader
+    VUniverse.init(this, {}, {});
 
     VNorm.init(this, {
         {0, sizeof(VertexNorm), VK_VERTEX_INPUT_RATE_VERTEX}
@@ -167,14 +181,15 @@ void GameMain::localInit() {
     // (pipelinesAndDescriptorSetsInit)
     // Be sure to cleanup and to destroy this at
     // src/game/cleanup.cpp
-    PPlain.init(this,
-        &VUV,
-        "shaders/PlainVert.spv",
-        "shaders/PlainFrag.spv",
+    PSkybox.init(this,
+        &VUniverse,
+        "shaders/SkyboxVert.spv",
+        "shaders/SkyboxFrag.spv",
         {&DSLUniverse});
-    // Disable backface culling for plain rendering
-        PPlain.setAdvancedFeatures(
-            VK_COMPARE_OP_LESS,
+    // The triangle covers the screen whatever its winding, at the far plane
+    // where the depth is cleared to
+        PSkybox.setAdvancedFeatures(
+            VK_COMPARE_OP_LESS_OR_EQUAL,
             VK_POLYGON_MODE_FILL,
             VK_CULL_MODE_NONE,
             false);
@@ -183,13 +198,21 @@ void GameMain::localInit() {
         &VNormUV,
         "shaders/MeshVert.spv",
         "shaders/MeshFrag.spv",
-        {&DSLSun, &DSLSPaceShip});
+        {&DSLSun, &DSLSPaceShip, &DSLPToonLight});
 
     PAsteroids.init(this,
         &VNormTanUV,
         "shaders/AsteroidsVert.spv",
         "shaders/AsteroidsFrag.spv",
         {&DSLSun, &DSLAsteroids});
+    PAsteroidsFar.init(this,
+        &VNormTanUV,
+        "shaders/AsteroidsVert.spv",
+        "shaders/AsteroidsFrag.spv",
+        {&DSLSun, &DSLAsteroids});
+    specializeShading(PMesh, true);
+    specializeShading(PAsteroids, true);
+    specializeShading(PAsteroidsFar, false);
     PTorus.init(this,
         &VTorus,
         "shaders/TorusVert.spv",
@@ -212,12 +235,30 @@ void GameMain::localInit() {
         "shaders/EarthVert.spv",
         "shaders/EarthFrag.spv",
         {&DSLSun,&DSLEarth});//to be edited to accomodate the descriptor set layout for the sun
+    specializeShading(PEarth, true);
     PText.init(this, 
         &VText, 
         "shaders/TextVert.spv", 
         "shaders/TextFrag.spv", 
         {&DSLText});
-    PText.setAdvancedFeatures(VK_COMPARE_OP_LESS_OR_EQUAL,VK_POLYGON_MODE_FILL,VK_CULL_MODE_NONE,false);    
+    PText.setAdvancedFeatures(VK_COMPARE_OP_LESS_OR_EQUAL,VK_POLYGON_MODE_FILL,VK_CULL_MODE_NONE,false);
+    // at native resolution, over the scaled scene
+    PText.overlay = true;    
+
+    if(gpuCulling) {
+        // Same layouts as PAsteroids, DSAsteroids is bound to both
+        PCullAsteroids.init(this,
+            "shaders/CullAsteroidsComp.spv",
+            {&DSLSun, &DSLAsteroids});
+        PHiZOccluders.init(this,
+            "shaders/HiZOccludersComp.spv",
+            {&DSLSun, &DSLAsteroids});
+        // the push constant is the level written
+        PHiZDownsample.init(this,
+            "shaders/HiZDownsampleComp.spv",
+            {&DSLSun, &DSLAsteroids},
+            sizeof(uint32_t));
+    }
 
     // Load the objects data specifying
     //      1. The vertext type to load
@@ -225,10 +266,6 @@ void GameMain::localInit() {
     //      3. The type of the file
     // Be sure to cleanup this at
     // src/game/cleanup.cpp
-    MUniverse.init(this,
-        &VUV,
-        "Assets/Objects/Sphere.gltf",
-        GLTF);
 
     MMesh.init(this,
         &VNormUV,
@@ -283,7 +320,8 @@ void GameMain::localInit() {
     //      1. The file name
     // Be sure to cleanup this at
     // src/game/cleanup.cpp
-    TUniverse.init(this,
+    // A cube map converted from the equirectangular image
+    TUniverse.initEquirect(this,
         "Assets/Textures/HDRI-space2.jpeg");
 
     TMesh.init(this,
@@ -311,26 +349,54 @@ void GameMain::localInit() {
 
     TBoost.init(this, 
         "Assets/Textures/Boost.png");
+    // Textures with the same sampling parameters share the sampler
+    logDebug("Live samplers: %zu", samplerCache.liveSamplers());
+    // The transient attachments of the frame, with their memory shared where
+    // their passes do not overlap
+    logDebug("Render graph: %.1f MB of transient images (%.1f MB lazily allocated), %.1f MB without aliasing",
+        renderGraph.allocatedBytes / 1048576.0, renderGraph.lazyBytes / 1048576.0,
+        renderGraph.requestedBytes / 1048576.0);
 
     // You can initialize here the matrices used for static transformations
     
-    // Global World Matrix for universe
-    UGWM = glm::scale(I, glm::vec3(100));
     // Global World Matrix for the sun
     USun = glm::scale(I, glm::vec3(20));
     UEarth = glm::scale(I, glm::vec3(10));
     Uast = glm::scale(I, glm::vec3(1.25));
+    UCrystal = glm::scale(I, glm::vec3(0.5));
+    initBounds();
+    if(benchmarkFrames) {
+        initFlightPath(*game);
+    }
+    startSimulation();
+}
+
+// The lighting constants shared by the lit shaders, and what the quality
+// leaves on
+void GameMain::specializeShading(Pipeline &P, bool normalMapping) {
+    P.setConstant(LIGHT_BETA, 0.1f);
+    P.setConstant(LIGHT_G, 8.0f);
+    P.setConstant(SPECULAR_POWER, 160.0f);
+    P.setConstant(AMBIENT_SCALE, 1.0f / 8.0f);
+    P.setConstant(NORMAL_MAPPING, normalMapping && !lowQualityShading);
+    P.setConstant(SPECULAR, !lowQualityShading);
 }
 
 void GameMain::pipelinesAndDescriptorSetsInit() {
-    PPlain.create(); //this pipeline is used for the universe and to apply the 'Plain' shader
+    PSkybox.create(); //this pipeline is used for the universe
     PMesh.create(); 
     PAsteroids.create();
+    PAsteroidsFar.create();
     PTorus.create();
     PSun.create();
     PEarth.create();
     PCrystal.create();
     PText.create();
+    if(gpuCulling) {
+        PCullAsteroids.create();
+        PHiZOccluders.create();
+        PHiZDownsample.create();
+    }
 
     // Initialize the Descriptor Set specifying
     //      1. A reference to its layout
@@ -344,7 +410,7 @@ void GameMain::pipelinesAndDescriptorSetsInit() {
     // Be sure to cleanup these at
     // src/game/cleanup.cpp
     DSUniverse.init(this, &DSLUniverse, {
-        {0, UNIFORM, sizeof(PlainUniformBlock), nullptr},
+        {0, UNIFORM, sizeof(SkyboxUniformBlock), nullptr},
         {1, TEXTURE, 0, &TUniverse}
     });
 
@@ -363,23 +429,53 @@ void GameMain::pipelinesAndDescriptorSetsInit() {
     });
 
     DSPToonLight.init(this, &DSLPToonLight, {
-        {0, UNIFORM, sizeof(GlobalUniformBlockPointLight), nullptr},
-        {1, TEXTURE, 0, &TToon}
+        {0, UNIFORM, sizeof(ClusterUniformBlock), nullptr},
+        {1, TEXTURE, 0, &TToon},
+        {2, STORAGE, static_cast<int>(sizeof(PointLight) * glm::max<size_t>(game->powerUps.size(), 1)), nullptr},
+        {3, STORAGE, sizeof(glm::uvec2) * CLUSTER_COUNT, nullptr},
+        {4, STORAGE, sizeof(uint32_t) * CLUSTER_INDEX_CAPACITY, nullptr}
     });
 
     DSSunLight.init(this, &DSLSun, {
         {0, UNIFORM, sizeof(GlobalUniformBlockPointLight), nullptr}
     });
 
-    for(int i = 0; i<ASTEROIDS; i++) {
-        DSAsteroids[i].init(this, &DSLAsteroids, {
-            {0, UNIFORM, sizeof(MeshUniformBlock), nullptr},
-            {1, TEXTURE, 0, &TAsteroids},
-            {2, TEXTURE, 0, &TAsteroidsNormMap}
+    // Storage buffers can not be empty
+    size_t asteroidSlots = glm::max<size_t>(uboAsteroids.size(), 1);
+    // every level of the depth pyramid, one after the other
+    size_t hizTexels = 0;
+    for(size_t side = HIZ_SIZE; occlusionCulling && side > 0; side /= 2) {
+        hizTexels += side * side;
+    }
+    std::vector<DescriptorSetElement> asteroidElements = {
+        {0, STORAGE, static_cast<int>(sizeof(MeshUniformBlock) * asteroidSlots), nullptr},
+        {1, TEXTURE, 0, &TAsteroids},
+        {2, TEXTURE, 0, &TAsteroidsNormMap}
+    };
+    if(gpuCulling) {
+        asteroidElements.insert(asteroidElements.end(), {
+            {3, STORAGE, static_cast<int>(sizeof(glm::vec4) * asteroidSlots), nullptr},
+            // read by the indirect draw
+            {4, INDIRECT, sizeof(AsteroidDraw), nullptr},
+            {5, UNIFORM, sizeof(CullUniformBlock), nullptr},
+            {6, STORAGE, static_cast<int>(sizeof(float) * glm::max<size_t>(hizTexels, 1)), nullptr}
         });
     }
+    DSAsteroids.init(this, &DSLAsteroids, asteroidElements);
+    if(gpuCulling && !game->asteroids.empty()) {
+        // the bounding spheres of the asteroids never change
+        std::vector<glm::vec4> spheres(game->asteroids.size());
+        for(size_t i = 0; i < spheres.size(); i++) {
+            spheres[i] = glm::vec4(game->asteroids[i].position, game->asteroids[i].radius);
+        }
+        AsteroidDraw draw{};
+        for(size_t i = 0; i < swapChainImages.size(); i++) {
+            DSAsteroids.map(i, spheres.data(), sizeof(glm::vec4) * spheres.size(), 3);
+            DSAsteroids.map(i, &draw, sizeof(draw), 4);
+        }
+    }
 
-    for(int i = 0; i<POWERUPS; i++) {
+    for(size_t i = 0; i<DSCrystal.size(); i++) {
         DSCrystal[i].init(this, &DSLCrystal, {
             {0, UNIFORM, sizeof(MeshUniformBlock), nullptr}
         });
@@ -401,108 +497,109 @@ void GameMain::pipelinesAndDescriptorSetsInit() {
 }
 
 void GameMain::populateCommandBuffer(VkCommandBuffer commandBuffer, int currentImage) {
+    // Serial recording, the whole scene in one go
+    recordStats[0] = renderQueue.record(commandBuffer, currentImage, 0, sceneDraws());
+}
 
-    // Steps to populate the command buffer and actually draw elements
-    //      - Set the proper pipeline
-    //      - Set the desired object
-    //      - Set the need DescriptorSets, also specifying
-    //          1. The pipeline to use
-    //          2. The ID to map the set to (as used in the shader)
-    //      - Invoke the function to actually draw the elements,
-    //        additional parameters are required
-    PPlain.bind(commandBuffer);
-    MUniverse.bind(commandBuffer);
-    DSUniverse.bind(commandBuffer, PPlain, 0, currentImage);
-    vkCmdDrawIndexed(commandBuffer,
-        static_cast<uint32_t>(MUniverse.indices.size()),
-        1,
-        0,
-        0 ,
-        0);
-    PSun.bind(commandBuffer);
-    MSun.bind(commandBuffer);
-    DSSun.bind(commandBuffer, PSun, 0, currentImage);
-    vkCmdDrawIndexed(commandBuffer,
-        static_cast<uint32_t>(MSun.indices.size()),
-        1,
-        0,
-        0 ,
-        0);
-
-    DSSunLight.bind(commandBuffer, PMesh, 0, currentImage);
-    PMesh.bind(commandBuffer);
-    
-    MMesh.bind(commandBuffer);
-    DSMesh.bind(commandBuffer, PMesh, 1, currentImage);
-    vkCmdDrawIndexed(commandBuffer,
-        static_cast<uint32_t>(MMesh.indices.size()),
-        1,
-        0,
-        0 ,
-        0);
-    
-    MAsteroids.bind(commandBuffer);
-    PAsteroids.bind(commandBuffer);
-    for(int i=0; i<ASTEROIDS; i++) {
-        DSAsteroids[i].bind(commandBuffer, PAsteroids, 1, currentImage);
-        vkCmdDrawIndexed(commandBuffer,
-            static_cast<uint32_t>(MAsteroids.indices.size()),
-            1,
+void GameMain::populateComputeCommands(VkCommandBuffer commandBuffer, int currentImage) {
+    if(!gpuCulling || game->asteroids.empty()) {
+        return;
+    }
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+
+    if(occlusionCulling) {
+        // Depth pyramid: the first level from the occluders, then each
+        // level from the one below, waiting for it to be written
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        PHiZOccluders.bind(commandBuffer);
+        DSAsteroids.bind(commandBuffer, PHiZOccluders, 1, currentImage);
+        vkCmdDispatch(commandBuffer, (HIZ_SIZE + 7) / 8, (HIZ_SIZE + 7) / 8, 1);
+
+        PHiZDownsample.bind(commandBuffer);
+        DSAsteroids.bind(commandBuffer, PHiZDownsample, 1, currentImage);
+        for(uint32_t level = 1; (HIZ_SIZE >> level) > 0; level++) {
+            vkCmdPipelineBarrier(commandBuffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0,
+                1, &barrier,
+                0, nullptr,
+                0, nullptr);
+            PHiZDownsample.push(commandBuffer, &level);
+            uint32_t groups = ((HIZ_SIZE >> level) + 7) / 8;
+            vkCmdDispatch(commandBuffer, groups, groups, 1);
+        }
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
             0,
-            0 ,
-            0);
+            1, &barrier,
+            0, nullptr,
+            0, nullptr);
     }
 
-    PTorus.bind(commandBuffer);
-    MTorus.bind(commandBuffer);
-    DSSunLight.bind(commandBuffer, PTorus, 0, currentImage);
-    DSTorus.bind(commandBuffer, PTorus, 1, currentImage);
-    vkCmdDrawIndexed(commandBuffer,
-        static_cast<uint32_t>(MTorus.indices.size()),
+    PCullAsteroids.bind(commandBuffer);
+    DSAsteroids.bind(commandBuffer, PCullAsteroids, 1, currentImage);
+    vkCmdDispatch(commandBuffer,
+        static_cast<uint32_t>((game->asteroids.size() + 63) / 64),
         1,
+        1);
+
+    // the draw reads the instances and the command written by the shader
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
         0,
-        0 ,
-        0);
-    PEarth.bind(commandBuffer);
-    MEarth.bind(commandBuffer);
-    DSEarth.bind(commandBuffer, PEarth, 1, currentImage);
-    vkCmdDrawIndexed(commandBuffer,
-        static_cast<uint32_t>(MEarth.indices.size()),
-        1,
-        0,
-        0 ,
-        0);
-    DSPToonLight.bind(commandBuffer, PCrystal, 0, currentImage);
-
-    MCrystal.bind(commandBuffer);
-    PCrystal.bind(commandBuffer);
-    for(int i=0; i<POWERUPS; i++) {
-        DSCrystal[i].bind(commandBuffer, PCrystal, 1, currentImage);
-        vkCmdDrawIndexed(commandBuffer,     
-            static_cast<uint32_t>(MCrystal.indices.size()), 
-            1, 
-            0, 
-            0,
-            0);
+        1, &barrier,
+        0, nullptr,
+        0, nullptr);
+}
+
+void GameMain::populateFinalCommands(VkCommandBuffer commandBuffer, int currentImage) {
+    if(!gpuCulling || !cullingStatistics || game->asteroids.empty()) {
+        return;
     }
+    // the counts written by CullAsteroids.comp are read back by drawScreen
+    // once the fence of the image is signaled, which alone does not make
+    // them visible to the host
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        1, &barrier,
+        0, nullptr,
+        0, nullptr);
+}
 
-    PText.bind(commandBuffer);
-	MText.bind(commandBuffer);
-	DSText.bind(commandBuffer, PText, 0, currentImage);
-	vkCmdDrawIndexed(commandBuffer,
-		static_cast<uint32_t>(MText.indices.size()), 
-        1, 
-        0, 
-        0, 
-        0);
-
-    PText.bind(commandBuffer);
-	MBoost.bind(commandBuffer);
-	DSBoost.bind(commandBuffer, PText, 0, currentImage);
-	vkCmdDrawIndexed(commandBuffer,
-		static_cast<uint32_t>(MBoost.indices.size()), 
-        1, 
-        0, 
-        0, 
-        0);
-}
\ No newline at end of file
+int GameMain::commandGroups() {
+    size_t groups = sceneDraws() / GROUP_DRAWS;
+    return static_cast<int>(std::clamp<size_t>(groups, 1, RECORD_GROUPS));
+}
+
+size_t GameMain::sceneDraws() {
+    // with dynamicResolution the HUD is drawn after the upscale by
+    // populateOverlayCommands
+    return dynamicResolution ? renderQueue.passBegin(OVERLAY_PASS) : renderQueue.size();
+}
+
+void GameMain::populateOverlayCommands(VkCommandBuffer commandBuffer, int currentImage) {
+    recordStats[RECORD_GROUPS] = renderQueue.record(commandBuffer, currentImage,
+        sceneDraws(), renderQueue.size());
+}
+
+void GameMain::populateCommandGroup(VkCommandBuffer commandBuffer, int currentImage, int group) {
+    // Each group is recorded in its own command buffer with a slice of the
+    // sorted draws, it starts with nothing bound
+    size_t draws = sceneDraws();
+    size_t groups = commandGroups();
+    recordStats[group] = renderQueue.record(commandBuffer, currentImage,
+        draws * group / groups, draws * (group + 1) / groups);
+}
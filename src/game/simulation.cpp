@@ -0,0 +1,63 @@
+// Runs the simulation, on its own thread or on the render thread
+#include "game_main.hpp"
+#include "log.h"
+#include <chrono>
+
+// Longest time the simulation thread tries to catch up, if it falls further
+// behind the game slows down instead of running a burst of ticks
+#define MAX_CATCH_UP 0.25
+
+void GameMain::startSimulation() {
+    // the renderer needs a snapshot before the first frame
+    stepSimulation(ControlInput());
+
+    if(simulationThread) {
+        simulationRunning = true;
+        simulationWorker = std::thread(&GameMain::simulationLoop, this);
+        logDebug("Simulation thread started (%.0f ticks/s)", tickRate);
+    }
+}
+
+void GameMain::stopSimulation() {
+    if(simulationWorker.joinable()) {
+        simulationRunning = false;
+        simulationWorker.join();
+        logDebug("Simulation thread stopped after %lu ticks", game->ticks);
+    }
+}
+
+// A tick with the given input, then publish its result
+void GameMain::stepSimulation(const ControlInput &input) {
+    game->step(1.0f / tickRate, input);
+
+    GameSnapshot &snapshot = snapshots.writeBuffer();
+    snapshot.ticks = game->ticks;
+    snapshot.previous = game->ticks > 1 ? game->previous : game->current;
+    snapshot.current = game->current;
+    snapshot.checkpoint = game->curr_check();
+    snapshot.boost = game->boost;
+    snapshot.published = std::chrono::steady_clock::now();
+    snapshots.publish();
+}
+
+void GameMain::simulationLoop() {
+    typedef std::chrono::steady_clock clock;
+    const clock::duration tick = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(1.0 / tickRate));
+    const clock::duration maxCatchUp = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(MAX_CATCH_UP));
+
+    clock::time_point next = clock::now() + tick;
+    while(simulationRunning) {
+        // the same input is used until the render thread reads a new one
+        inputs.update();
+        stepSimulation(inputs.read());
+
+        clock::time_point now = clock::now();
+        if(now - next > maxCatchUp) {
+            next = now;
+        }
+        std::this_thread::sleep_until(next);
+        next += tick;
+    }
+}
@@ -0,0 +1,130 @@
+#include "spatial_grid.hpp"
+#include <algorithm>
+#include <cmath>
+
+// 21 bits for each coordinate, enough for +-10^6 cells per axis
+#define CELL_BITS 21
+#define CELL_MASK ((1ull << CELL_BITS) - 1)
+
+SpatialGrid::SpatialGrid(float cellSize) {
+    this->cellSize = cellSize;
+}
+
+glm::ivec3 SpatialGrid::cellOf(glm::vec3 p) const {
+    return glm::ivec3(glm::floor(p / cellSize));
+}
+
+uint64_t SpatialGrid::key(int x, int y, int z) {
+    return  ((uint64_t)x & CELL_MASK)
+        | (((uint64_t)y & CELL_MASK) << CELL_BITS)
+        | (((uint64_t)z & CELL_MASK) << (2 * CELL_BITS));
+}
+
+void SpatialGrid::link(int id) {
+    Sphere &s = spheres[id];
+    s.minCell = cellOf(s.position - glm::vec3(s.radius));
+    s.maxCell = cellOf(s.position + glm::vec3(s.radius));
+    for(int x = s.minCell.x; x <= s.maxCell.x; x++) {
+        for(int y = s.minCell.y; y <= s.maxCell.y; y++) {
+            for(int z = s.minCell.z; z <= s.maxCell.z; z++) {
+                cells[key(x, y, z)].push_back(id);
+            }
+        }
+    }
+}
+
+void SpatialGrid::unlink(int id) {
+    Sphere &s = spheres[id];
+    for(int x = s.minCell.x; x <= s.maxCell.x; x++) {
+        for(int y = s.minCell.y; y <= s.maxCell.y; y++) {
+            for(int z = s.minCell.z; z <= s.maxCell.z; z++) {
+                auto cell = cells.find(key(x, y, z));
+                if(cell == cells.end()) {
+                    continue;
+                }
+                std::vector<int> &ids = cell->second;
+                auto it = std::find(ids.begin(), ids.end(), id);
+                if(it != ids.end()) {
+                    *it = ids.back();
+                    ids.pop_back();
+                }
+                if(ids.empty()) {
+                    cells.erase(cell);
+                }
+            }
+        }
+    }
+}
+
+int SpatialGrid::insertStatic(glm::vec3 position, float radius) {
+    spheres.push_back({position, radius, false, glm::ivec3(0), glm::ivec3(0)});
+    stamps.push_back(0);
+    link(spheres.size() - 1);
+    return spheres.size() - 1;
+}
+
+int SpatialGrid::insertDynamic(glm::vec3 position, float radius) {
+    spheres.push_back({position, radius, true, glm::ivec3(0), glm::ivec3(0)});
+    stamps.push_back(0);
+    link(spheres.size() - 1);
+    return spheres.size() - 1;
+}
+
+void SpatialGrid::move(int id, glm::vec3 position) {
+    Sphere &s = spheres[id];
+    if(!s.dynamic) {
+        return;
+    }
+    s.position = position;
+    // only touch the cells if the sphere left the ones it is registered in
+    if(cellOf(position - glm::vec3(s.radius)) != s.minCell
+        || cellOf(position + glm::vec3(s.radius)) != s.maxCell) {
+        unlink(id);
+        link(id);
+    }
+}
+
+void SpatialGrid::clear() {
+    spheres.clear();
+    cells.clear();
+    stamps.clear();
+}
+
+size_t SpatialGrid::query(glm::vec3 position, float radius, std::vector<int> &hits) const {
+    size_t found = 0;
+    if(++queryCount == 0) {
+        // stamps wrapped around, forget the old ones
+        std::fill(stamps.begin(), stamps.end(), 0);
+        queryCount = 1;
+    }
+
+    glm::ivec3
+        minCell = cellOf(position - glm::vec3(radius)),
+        maxCell = cellOf(position + glm::vec3(radius));
+    for(int x = minCell.x; x <= maxCell.x; x++) {
+        for(int y = minCell.y; y <= maxCell.y; y++) {
+            for(int z = minCell.z; z <= maxCell.z; z++) {
+                auto cell = cells.find(key(x, y, z));
+                if(cell == cells.end()) {
+                    continue;
+                }
+                for(int id : cell->second) {
+                    // spheres spanning several cells are tested once
+                    if(stamps[id] == queryCount) {
+                        continue;
+                    }
+                    stamps[id] = queryCount;
+
+                    const Sphere &s = spheres[id];
+                    glm::vec3 d = s.position - position;
+                    float r = s.radius + radius;
+                    if(glm::dot(d, d) < r * r) {
+                        hits.push_back(id);
+                        found++;
+                    }
+                }
+            }
+        }
+    }
+    return found;
+}
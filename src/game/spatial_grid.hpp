@@ -0,0 +1,48 @@
+#ifndef SPATIAL_GRID_HPP
+#define SPATIAL_GRID_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Uniform grid stored in a hash map, used as broad phase for sphere
+// collisions: each sphere is registered in every cell its bounding box
+// overlaps, a query only tests the spheres found in the cells it overlaps.
+// Static spheres are inserted once, dynamic ones can be moved around.
+// Queries are not thread safe (they share the deduplication stamps)
+class SpatialGrid {
+    struct Sphere {
+        glm::vec3 position;
+        float radius;
+        bool dynamic;
+        // cells the sphere is currently registered in
+        glm::ivec3 minCell, maxCell;
+    };
+
+    float cellSize;
+    std::vector<Sphere> spheres;
+    std::unordered_map<uint64_t, std::vector<int>> cells;
+    // last query which visited each sphere
+    mutable std::vector<uint32_t> stamps;
+    mutable uint32_t queryCount = 0;
+
+    glm::ivec3 cellOf(glm::vec3 p) const;
+    static uint64_t key(int x, int y, int z);
+    void link(int id);
+    void unlink(int id);
+public:
+    SpatialGrid(float cellSize = 16.0f);
+    int insertStatic(glm::vec3 position, float radius);
+    int insertDynamic(glm::vec3 position, float radius);
+    // only for dynamic spheres
+    void move(int id, glm::vec3 position);
+    void clear();
+    inline size_t size() const { return spheres.size(); }
+
+    // Append to hits the ids of the spheres overlapping the given one,
+    // returns the number of ids appended
+    size_t query(glm::vec3 position, float radius, std::vector<int> &hits) const;
+};
+
+#endif//SPATIAL_GRID_HPP
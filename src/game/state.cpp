@@ -1,28 +1,31 @@
 // Manages the gamestate
 #include "game_model.hpp"
 #include "log.h"
+#include <cstdint>
 #include <vector>
 
-bool GameModel::collision() {
-    for(ColliderObject el : this->asteroids) {
-        if(character->collision(el)){
-            return true;
-        }
+const std::vector<int>& GameModel::collision() {
+    asteroidHits.clear();
+    if(asteroids.size() <= BROAD_PHASE_THRESHOLD) {
+        asteroidStore.overlaps(character.position, character.radius, asteroidHits);
+    } else {
+        asteroidGrid.query(character.position, character.radius, asteroidHits);
     }
-    return false;
+    return asteroidHits;
 }
 
-bool GameModel::on_crystal() {
-    for(ColliderObject el : this->powerUps) {
-        if(character->collision(el)) {
-            return true;
-        }
+const std::vector<int>& GameModel::on_crystal() {
+    powerUpHits.clear();
+    if(powerUps.size() <= BROAD_PHASE_THRESHOLD) {
+        powerUpStore.overlaps(character.position, character.radius, powerUpHits);
+    } else {
+        powerUpGrid.query(character.position, character.radius, powerUpHits);
     }
-    return false;
+    return powerUpHits;
 }
 
 bool GameModel::race_check() {
-    return character->collision(checkpoints[current_checkpoint]);
+    return character.collision(checkpoints[current_checkpoint]);
 }
 
 bool GameModel::race_make_next() {
@@ -32,4 +35,44 @@ bool GameModel::race_make_next() {
     } else {
         return false;
     }
-}
\ No newline at end of file
+}
+
+// FNV-1a over the bytes of the values, floats included: two runs match only
+// if they are bit exact
+static void hashBytes(uint64_t &h, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for(size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * 0x100000001b3ull;
+    }
+}
+
+template <class T>
+static void hashValue(uint64_t &h, const T &value) {
+    hashBytes(h, &value, sizeof(T));
+}
+
+uint64_t GameModel::hash() const {
+    uint64_t h = 0xcbf29ce484222325ull;
+    hashValue(h, (uint64_t)ticks);
+    hashValue(h, time);
+    hashValue(h, character.position);
+    hashValue(h, character.rotation);
+    hashValue(h, camera.position);
+    hashValue(h, current.FOVy);
+    hashValue(h, current_checkpoint);
+    hashValue(h, tickState.Momentum);
+    hashValue(h, tickState.boost_time);
+    hashValue(h, tickState.checkpoint_delay);
+    hashValue(h, (uint8_t)boost);
+    return h;
+}
+
+RenderState GameSnapshot::interpolate(float alpha) const {
+    RenderState state;
+    state.time = glm::mix(previous.time, current.time, alpha);
+    state.position = glm::mix(previous.position, current.position, alpha);
+    state.rotation = glm::slerp(previous.rotation, current.rotation, alpha);
+    state.camera = glm::mix(previous.camera, current.camera, alpha);
+    state.FOVy = glm::mix(previous.FOVy, current.FOVy, alpha);
+    return state;
+}
@@ -0,0 +1,175 @@
+// Advances a GameModel by one tick, needs neither a window nor a GPU
+#include "game_model.hpp"
+#include "log.h"
+#include <cmath>
+
+#define SPEED_EFFECT_DAMPING 2.0f
+#define ROTATION_EFFECT_DAMPING 8.0f
+
+// Generic damp function
+template <class T>
+static inline T damp(T oldVal, T newVal, float lambda, float dt) {
+	return
+		(oldVal * (float)pow(M_E,-lambda * dt) ) +
+		(newVal * (float)(1-pow(M_E, -lambda * dt)));
+}
+
+// The first value goes through as it is, the following ones are damped
+// towards the new value
+template <class T>
+T Damped<T>::operator()(T newVal, float lambda, float dt) {
+	value = primed ? damp<T>(value, newVal, lambda, dt) : newVal;
+	primed = true;
+	return value;
+}
+
+#define DAMP(T, val, lambda)\
+	do{\
+		val = tickState.val##Old(val, lambda, deltaT);\
+	}while(0)
+
+// A single step of the simulation, deltaT is the same for every tick
+void GameModel::step(float deltaT, const ControlInput &input) {
+	glm::vec3 m = input.m, r = input.r;
+	bool fire = input.fire;
+	previous = current;
+
+	// Camera target height and distance
+	const float camHeight = 0.26;
+	const float camDist = 2.2;
+	// Rotation and motion speed
+	const float ROT_SPEED = glm::radians(120.0f);
+
+	TickState &state = tickState;
+	//here we convert the time passed since last tick into an actual "timestamp" 
+	time += deltaT;
+
+	float
+		MOVE_SPEED = 2;//standard movement speed
+	float Extra=0;//extra speed gained by the boost obtained by crystals
+	const float CAP_SPEED=8;//max speed reachable 
+
+	float
+		//variable FOV, to be changed depending on the presence of "boost mode" 
+		FOVy = glm::radians(45.0f);
+
+	// check if collision happened with a crystal
+	bool was_on_crystal = state.is_on_crystal; //here i store the the value in another variable
+	bool is_on_crystal = state.is_on_crystal = !on_crystal().empty(); //here i update the value to the current status
+
+	//if we are on a crystal and we werent before, add 4 seconds of boost time 
+	if(is_on_crystal && (! was_on_crystal)) {
+		state.boost_time += 4;
+		stats.powerUps++;
+		logDebug("Power up");
+	}
+	
+	MOVE_SPEED = 2;
+	Extra=0;
+	FOVy = glm::radians(45.0f);
+	//if we don't have anymore boost we don't show any boost icon
+	if(state.boost_time <= 0.0f) {
+		boost = false;
+		state.boost_time = 0.0f;
+	} else {
+		//if we have boost time we show the icon in the upright corner of the window
+		boost = true;
+		//if we activate the boost we increase move speed and cange the FOV to "curve spacetime"
+		if(fire && m.z > 0) {
+			MOVE_SPEED = 8;
+			Extra=25; //I want to go really fast foward
+				FOVy = glm::radians(100.0f);
+				r.x *= 0.5; // You are going into the hyperspace, drift with care
+				r.y *= 0.5;
+				state.boost_time -= deltaT;
+		}
+	}
+
+	// Game Logic implementation
+	// Rotation of the player in this tick, what lasts between the ticks
+	// is kept in tickState
+	float CamYaw = -ROT_SPEED * deltaT * r.y;
+	float CamPitch  = -ROT_SPEED * deltaT * r.x;
+	float CamRoll   = ROT_SPEED * deltaT * r.z;
+
+	//quaternion making to avoid gimball lock on the starhip rotation
+	character.rotation *=
+		  glm::rotate(glm::quat(1,0,0,0), CamPitch, glm::vec3(1,0,0))
+		* glm::rotate(glm::quat(1,0,0,0), CamYaw, glm::vec3(0,1,0))
+		* glm::rotate(glm::quat(1,0,0,0), CamRoll, glm::vec3(0,0,1));
+	//quaternion matrix, used in the world matrix for simplicity and in the creation of uy and uz
+	glm::mat4 MQ = glm::mat4(character.rotation);
+
+	glm::vec3 uy = glm::vec3(MQ * glm::vec4(0,1,0,1));
+	glm::vec3 uz = glm::vec3(MQ * glm::vec4(0,0,-1,1));
+
+	DAMP(float, MOVE_SPEED, SPEED_EFFECT_DAMPING);
+	DAMP(float, FOVy, SPEED_EFFECT_DAMPING);
+	float &Momentum = state.Momentum;
+	
+	if(m.z>0)Momentum+=MOVE_SPEED*deltaT;
+	else if(m.z<0) Momentum-=3*MOVE_SPEED*deltaT; //3* to make it hadle better
+	else Momentum-=Momentum*(deltaT); //decrease momentum gradually
+	Momentum=glm::max(-CAP_SPEED/3.0f,glm::min(Momentum,CAP_SPEED+Extra)); 
+	//caps the speed, I wanna be slower in reverse cuz game mechanics
+
+
+	//we calculate initial position 
+	//we do not use the left/right up/down translation on the starship
+	//character.position += Momentum.y * uy * deltaT; //for debugging
+	character.position += Momentum * uz * deltaT;
+	//we calculate initial position 
+	//we do not use the left and right translation on the starship
+	
+	float dist = glm::length(character.position); //how far are you from the center of the universe
+	//skybox limit collision and asteroids collision
+	if(!collision().empty()||(dist > bound)){ //Did you hit anything or are you going out of bounds
+		character.position -= 2*Momentum * uz * deltaT; //reset position
+		Momentum*=(-3); //invert movement (*3 for a satisfying bounce)
+		stats.bounces++;
+	}
+
+
+	glm::vec3 targetPosition = character.position;
+	//the camera position is based on the target position with two rotations and a translation at a certain distance
+	glm::vec3 cameraPosition = targetPosition+ camHeight*uy-camDist*uz;
+
+	DAMP(glm::vec3, cameraPosition, ROTATION_EFFECT_DAMPING);
+
+	camera.position = cameraPosition;
+
+	// check for game ended
+	bool was_checkpoint = state.is_checkpoint;
+	bool is_checkpoint = state.is_checkpoint = race_check();
+
+	// Check if game ended
+	if(is_checkpoint && !was_checkpoint) {
+		// a checkpoint is reached once, even if touched again while waiting
+		if(state.checkpoint_delay == 0.0f) {
+			stats.checkpoints++;
+			if(current_checkpoint == (int)checkpoints.size() - 1) {
+				if(stats.laps++ == 0) {
+					stats.lapTime = time;
+				}
+			}
+		}
+		state.checkpoint_delay = 2.0f;
+	}
+
+	if(state.checkpoint_delay > 0.0f) {
+		if((state.checkpoint_delay -= deltaT) <= 0.0f) {
+			state.checkpoint_delay = 0.0f;
+			if(race_make_next()) {
+				logDebug("Implement end game");
+			}
+		}
+	}
+
+	// what the frames need to render this tick
+	current.time = time;
+	current.position = targetPosition;
+	current.rotation = character.rotation;
+	current.camera = cameraPosition;
+	current.FOVy = FOVy;
+	ticks++;
+}
@@ -1,6 +1,7 @@
 #ifndef VERTEX_TYPES_HPP
 #define VERTEX_TYPES_HPP
 
+#include <cstdint>
 #include <glm/glm.hpp>
 
 struct MeshUniformBlock {
@@ -20,6 +21,46 @@ struct PlainUniformBlock {
 	alignas(16) glm::mat4 mMat;
 	alignas(4)  float time;
 };
+// Skybox drawn with a fullscreen triangle: the view direction of a pixel is
+// unprojected with invViewPrj, then rotated back by rotation
+struct SkyboxUniformBlock {
+	alignas(16) glm::mat4 invViewPrj;
+	alignas(16) glm::mat4 rotation;
+};
+// Parameters of the culling of the asteroid field on the GPU, see
+// shaders/CullAsteroids.comp
+struct CullUniformBlock {
+	alignas(16) glm::mat4 viewPrj;
+	alignas(16) glm::mat4 invViewPrj;
+	alignas(16) glm::vec4 planes[6];
+	alignas(16) glm::vec4 occluders[2];	// spheres, center and radius
+	alignas(4)  float time;
+	alignas(4)  float modelScale;	// from collider radius to model scale
+	alignas(4)  float boundRadius;	// of the model
+	alignas(4)  uint32_t count;
+	alignas(4)  uint32_t hizSize;	// side of the first level of the depth pyramid
+	alignas(4)  uint32_t hizLevels;	// 0 disables the occlusion test
+};
+
+// An entry of the light list of the clustered lighting, see
+// src/game/lights.cpp
+struct PointLight {
+	alignas(16) glm::vec4 position;	// w is the range, no light beyond it
+	alignas(16) glm::vec4 color;	// w is the distance of the full color, the
+									// light decays as w / distance
+};
+// Froxel grid of the clustered lighting: screen tiles times depth slices,
+// exponential between the near and the far plane
+struct ClusterUniformBlock {
+	alignas(16) glm::mat4 viewPrj;
+	alignas(16) glm::vec4 eyePos;
+	alignas(4)  float sliceScale;	// slice = log(depth) * sliceScale + sliceBias
+	alignas(4)  float sliceBias;
+	alignas(4)  uint32_t tilesX;
+	alignas(4)  uint32_t tilesY;
+	alignas(4)  uint32_t slices;
+};
+
 struct TextUniformBlock {
 	alignas(4) float visible;
 };
@@ -0,0 +1,54 @@
+#include <frame_stats.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+FrameStats::Summary FrameStats::summary(double Frame::*time) const {
+    std::vector<double> sorted;
+    sorted.reserve(samples.size());
+    for(const Frame &frame : samples) {
+        if(frame.*time >= 0.0) {
+            sorted.push_back(frame.*time);
+        }
+    }
+    Summary s{};
+    s.count = sorted.size();
+    if(sorted.empty()) {
+        return s;
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    // value below which the given fraction of the sorted values falls
+    auto percentile = [&](double fraction) {
+        return sorted[std::min(sorted.size() - 1, (size_t)(fraction * sorted.size()))];
+    };
+    double sum = 0.0;
+    for(double t : sorted) {
+        sum += t;
+    }
+    s.min = sorted.front();
+    s.mean = sum / sorted.size();
+    s.p50 = percentile(0.5);
+    s.p95 = percentile(0.95);
+    s.p99 = percentile(0.99);
+    s.max = sorted.back();
+    return s;
+}
+
+void FrameStats::writeCsv(const std::string &file) const {
+    FILE *out = fopen(file.c_str(), "w");
+    if(!out) {
+        throw std::runtime_error("Unable to create " + file);
+    }
+    fprintf(out, "frame,cpu_ms,fence_ms,gpu_ms\n");
+    for(size_t i = 0; i < samples.size(); i++) {
+        const Frame &f = samples[i];
+        fprintf(out, "%zu,%.4f,%.4f,", i, f.cpu * 1000.0, f.fence * 1000.0);
+        if(f.gpu >= 0.0) {
+            fprintf(out, "%.4f\n", f.gpu * 1000.0);
+        } else {
+            fprintf(out, "\n");
+        }
+    }
+    fclose(out);
+}
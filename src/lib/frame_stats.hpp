@@ -0,0 +1,37 @@
+#ifndef FRAME_STATS_HPP
+#define FRAME_STATS_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Times of every frame of a benchmark run, with their distribution and a
+// per-frame CSV. All times are in seconds.
+class FrameStats {
+public:
+    struct Frame {
+        double cpu;     // spent recording and submitting, fence waits excluded
+        double fence;   // waiting for the frames in flight
+        double gpu;     // of the last frame completed with the same image,
+                        // negative when no new measure was available
+    };
+    struct Summary {
+        size_t count;   // frames with a measure
+        double min, mean, p50, p95, p99, max;
+    };
+
+    inline void add(const Frame &frame) { samples.push_back(frame); }
+    inline const std::vector<Frame> &frames() const { return samples; }
+    inline void clear() { samples.clear(); }
+
+    // Of one of the times of the frames, e.g. summary(&Frame::gpu). The
+    // frames without a measure are skipped, count is 0 if none has one
+    Summary summary(double Frame::*time) const;
+    // One line for each frame, throws if the file can not be created
+    void writeCsv(const std::string &file) const;
+
+private:
+    std::vector<Frame> samples;
+};
+
+#endif//FRAME_STATS_HPP
@@ -0,0 +1,84 @@
+#include <input_log.hpp>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+static const char INPUT_LOG_MAGIC[4] = {'C', 'G', 'I', 'N'};
+static const uint32_t INPUT_LOG_VERSION = 1;
+// bits 0-5 are the axes, m.x m.y m.z r.x r.y r.z
+static const uint8_t INPUT_LOG_FIRE = 1 << 6;
+
+static float &axis(InputFrame &frame, int i) {
+    return i < 3 ? frame.m[i] : frame.r[i - 3];
+}
+
+InputRecorder::InputRecorder(const std::string &file) {
+    out.open(file, std::ios::binary | std::ios::trunc);
+    if(!out) {
+        throw std::runtime_error("failed to create input log " + file);
+    }
+    out.write(INPUT_LOG_MAGIC, sizeof(INPUT_LOG_MAGIC));
+    out.write((const char *)&INPUT_LOG_VERSION, sizeof(INPUT_LOG_VERSION));
+}
+
+InputRecorder::~InputRecorder() {
+    std::cout << "Recorded " << frames << " frames of input ("
+              << out.tellp() << " bytes)\n";
+}
+
+void InputRecorder::write(const InputFrame &frame) {
+    InputFrame f = frame;
+    uint8_t mask = f.fire ? INPUT_LOG_FIRE : 0;
+    for(int i = 0; i < 6; i++) {
+        if(axis(f, i) != 0.0f) {
+            mask |= 1 << i;
+        }
+    }
+    out.put((char)mask);
+    out.write((const char *)&f.deltaT, sizeof(float));
+    for(int i = 0; i < 6; i++) {
+        if(mask & (1 << i)) {
+            out.write((const char *)&axis(f, i), sizeof(float));
+        }
+    }
+    frames++;
+}
+
+InputReplay::InputReplay(const std::string &file) {
+    std::ifstream in(file, std::ios::binary);
+    if(!in) {
+        throw std::runtime_error("failed to open input log " + file);
+    }
+    char magic[sizeof(INPUT_LOG_MAGIC)];
+    uint32_t version;
+    in.read(magic, sizeof(magic));
+    in.read((char *)&version, sizeof(version));
+    if(!in || memcmp(magic, INPUT_LOG_MAGIC, sizeof(magic)) || version != INPUT_LOG_VERSION) {
+        throw std::runtime_error(file + " is not an input log");
+    }
+
+    int mask;
+    while((mask = in.get()) != EOF) {
+        InputFrame frame;
+        frame.fire = mask & INPUT_LOG_FIRE;
+        in.read((char *)&frame.deltaT, sizeof(float));
+        for(int i = 0; i < 6; i++) {
+            if(mask & (1 << i)) {
+                in.read((char *)&axis(frame, i), sizeof(float));
+            }
+        }
+        if(!in) {
+            throw std::runtime_error("truncated input log " + file);
+        }
+        frames.push_back(frame);
+    }
+    std::cout << "Replaying " << frames.size() << " frames of input from " << file << "\n";
+}
+
+bool InputReplay::read(InputFrame &frame) {
+    if(next >= frames.size()) {
+        return false;
+    }
+    frame = frames[next++];
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef INPUT_LOG_HPP
+#define INPUT_LOG_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// What BaseProject::getSixAxis returns for a frame
+struct InputFrame {
+    float deltaT = 0.0f;
+    glm::vec3 m = glm::vec3(0.0f);
+    glm::vec3 r = glm::vec3(0.0f);
+    bool fire = false;
+};
+
+// Binary log of the input of each frame, so that a flight can be played
+// again exactly. After an 8 bytes header ("CGIN" and the version) every
+// frame is a mask byte, with a bit for each non zero axis (m.x ... r.z) and
+// one for fire, followed by deltaT and the non zero axes as floats: idle
+// frames take 5 bytes, values are stored as they are (little endian hosts).
+class InputRecorder {
+    std::ofstream out;
+    size_t frames = 0;
+public:
+    InputRecorder(const std::string &file);
+    ~InputRecorder();
+    void write(const InputFrame &frame);
+};
+
+// Reads a whole log when created, no file access while playing it
+class InputReplay {
+    std::vector<InputFrame> frames;
+    size_t next = 0;
+public:
+    InputReplay(const std::string &file);
+    // false once the log is over
+    bool read(InputFrame &frame);
+    inline size_t size() const { return frames.size(); }
+};
+
+#endif//INPUT_LOG_HPP
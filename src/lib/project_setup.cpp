@@ -8,6 +8,7 @@
 
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
+// also stb_image_write.h, for the frames captured by headless
 #include <tiny_gltf.h>
 
 const std::vector<const char*> validationLayers = {
@@ -88,8 +89,15 @@ void BaseProject::run() {
     windowResizable = GLFW_FALSE;
 
    	setWindowParameters();
-       initWindow();
+       if(!headless) {
+           initWindow();
+       }
        initVulkan();
+       if(!replayInputFile.empty()) {
+           inputReplay = new InputReplay(replayInputFile);
+       } else if(!recordInputFile.empty()) {
+           inputRecorder = new InputRecorder(recordInputFile);
+       }
        mainLoop();
        cleanup();
 }
@@ -108,18 +116,34 @@ void BaseProject::initWindow() {
 }
 
 void BaseProject::initVulkan() {
+		if (dynamicResolution) {
+			// the controller reads the GPU time, the scale changes each frame
+			gpuTiming = true;
+			recordEveryFrame = true;
+		}
 		createInstance();				
 		setupDebugMessenger();			
-		createSurface();				
+		if (headless) {
+			// the offscreen images need no extension
+			deviceExtensions.erase(std::remove(deviceExtensions.begin(),
+					deviceExtensions.end(), std::string(VK_KHR_SWAPCHAIN_EXTENSION_NAME)),
+					deviceExtensions.end());
+		} else {
+			createSurface();				
+		}
 		pickPhysicalDevice();			
 		createLogicalDevice();			
-		createSwapChain();				
+		if (headless) {
+			createOffscreenImages();
+		} else {
+			createSwapChain();				
+		}
 		createImageViews();				
-		createRenderPass();			
+		createRenderGraph();
 		createCommandPool();			
-		createColorResources();
-		createDepthResources();			
-		createFramebuffers();			
+		if(parallelRecording) {
+			recordingPool = new WorkStealingPool();
+		}
 		createDescriptorPool();			
 
 		localInit();
@@ -184,13 +208,15 @@ void BaseProject:: createInstance() {
 }
 
 std::vector<const char*> BaseProject::getRequiredExtensions() {
-		uint32_t glfwExtensionCount = 0;
-		const char** glfwExtensions;
-		glfwExtensions =
-			glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-		std::vector<const char*> extensions(glfwExtensions,
-			glfwExtensions + glfwExtensionCount);
+		std::vector<const char*> extensions;
+		if (!headless) {
+			uint32_t glfwExtensionCount = 0;
+			const char** glfwExtensions;
+			glfwExtensions =
+				glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+			extensions.assign(glfwExtensions,
+				glfwExtensions + glfwExtensionCount);
+		}
 			
 		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);		
 		
@@ -360,7 +386,9 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 		devRep.extensionsSupported = checkDeviceExtensionSupport(device, devRep);
 
 		devRep.swapChainAdequate = false;
-		if (devRep.extensionsSupported) {
+		if (headless) {
+			devRep.swapChainAdequate = true;
+		} else if (devRep.extensionsSupported) {
 			SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
 			devRep.swapChainFormatSupport = swapChainSupport.formats.empty();
 			devRep.swapChainPresentModeSupport = swapChainSupport.presentModes.empty();
@@ -396,8 +424,13 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 			}
 				
 			VkBool32 presentSupport = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface,
-												 &presentSupport);
+			if (headless) {
+				// nothing is presented, the queue is only fetched
+				presentSupport = indices.graphicsFamily.has_value();
+			} else {
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface,
+													 &presentSupport);
+			}
 			if (presentSupport) {
 			 	indices.presentFamily = i;
 			}
@@ -498,6 +531,19 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 		VkPhysicalDeviceFeatures deviceFeatures{};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
 		deviceFeatures.sampleRateShading = VK_TRUE;
+		if (fragmentStatistics) {
+			VkPhysicalDeviceFeatures supportedFeatures;
+			vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+			// the secondary command buffers are executed inside the query
+			if (supportedFeatures.pipelineStatisticsQuery &&
+				(!parallelRecording || supportedFeatures.inheritedQueries)) {
+				deviceFeatures.pipelineStatisticsQuery = VK_TRUE;
+				deviceFeatures.inheritedQueries = parallelRecording ? VK_TRUE : VK_FALSE;
+			} else {
+				std::cout << "Pipeline statistics queries not supported, no fragment statistics\n";
+				fragmentStatistics = false;
+			}
+		}
 		
 		VkDeviceCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -551,6 +597,23 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 		createInfo.imageExtent = extent;
 		createInfo.imageArrayLayers = 1;
 		createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		if (dynamicResolution) {
+			// the scene is blitted to the swap chain images, from an image of
+			// the same format
+			VkFormatProperties props;
+			vkGetPhysicalDeviceFormatProperties(physicalDevice, surfaceFormat.format, &props);
+			VkFormatFeatureFlags blit = VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+					VK_FORMAT_FEATURE_BLIT_DST_BIT |
+					VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+			if ((props.optimalTilingFeatures & blit) == blit &&
+				(swapChainSupport.capabilities.supportedUsageFlags &
+				 VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+				createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			} else {
+				std::cout << "Filtered blit to the swap chain not supported, no dynamic resolution\n";
+				dynamicResolution = false;
+			}
+		}
 		
 		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 		uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(),
@@ -628,6 +691,40 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 		}
 	}
 
+    void BaseProject::createOffscreenImages() {
+		// PNG byte order, so that the captured frames are copied as they are
+		swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+		swapChainExtent = {windowWidth, windowHeight};
+
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, swapChainImageFormat, &props);
+		if (!(props.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT)) {
+			throw std::runtime_error("failed to find a format for the offscreen images!");
+		}
+		if (dynamicResolution) {
+			VkFormatFeatureFlags blit = VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+					VK_FORMAT_FEATURE_BLIT_DST_BIT |
+					VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+			if ((props.optimalTilingFeatures & blit) != blit) {
+				std::cout << "Filtered blit to the offscreen images not supported, no dynamic resolution\n";
+				dynamicResolution = false;
+			}
+		}
+
+		// one for each frame in flight, used in turn
+		swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+		offscreenImageMemory.resize(MAX_FRAMES_IN_FLIGHT);
+		for (size_t i = 0; i < swapChainImages.size(); i++) {
+			createImage(swapChainExtent.width, swapChainExtent.height, 1, 1,
+						VK_SAMPLE_COUNT_1_BIT, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+						VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+						VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+						VK_IMAGE_USAGE_TRANSFER_DST_BIT, 0,
+						VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+						swapChainImages[i], offscreenImageMemory[i]);
+		}
+	}
+
     void BaseProject::createImageViews() {
         swapChainImageViews.resize(swapChainImages.size());
 		
@@ -664,116 +761,64 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 		return imageView;
 	}
 
-    void BaseProject::createRenderPass() {
-		VkAttachmentDescription colorAttachmentResolve{};
-		colorAttachmentResolve.format = swapChainImageFormat;
-		colorAttachmentResolve.samples = VK_SAMPLE_COUNT_1_BIT;
-		colorAttachmentResolve.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		colorAttachmentResolve.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-		VkAttachmentReference colorAttachmentResolveRef{};
-		colorAttachmentResolveRef.attachment = 2;
-		colorAttachmentResolveRef.layout =
-						VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		
-		VkAttachmentDescription depthAttachment{};
-		depthAttachment.format = findDepthFormat();
-		depthAttachment.samples = msaaSamples;
-		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		depthAttachment.finalLayout =
-						VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-		VkAttachmentReference depthAttachmentRef{};
-		depthAttachmentRef.attachment = 1;
-		depthAttachmentRef.layout = 
-						VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    	VkAttachmentDescription colorAttachment{};
-		colorAttachment.format = swapChainImageFormat;
-		colorAttachment.samples = msaaSamples;
-		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		
-		VkAttachmentReference colorAttachmentRef{};
-		colorAttachmentRef.attachment = 0;
-		colorAttachmentRef.layout =
-				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		
-		VkSubpassDescription subpass{};
-		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		subpass.colorAttachmentCount = 1;
-		subpass.pColorAttachments = &colorAttachmentRef;
-		subpass.pDepthStencilAttachment = &depthAttachmentRef;
-		subpass.pResolveAttachments = &colorAttachmentResolveRef;
-		
-		VkSubpassDependency dependency{};
-		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependency.dstSubpass = 0;
-		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependency.srcAccessMask = 0;
-		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-		std::array<VkAttachmentDescription, 3> attachments =
-								{colorAttachment, depthAttachment,
-								 colorAttachmentResolve};
-
-		VkRenderPassCreateInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());;
-		renderPassInfo.pAttachments = attachments.data();
-		renderPassInfo.subpassCount = 1;
-		renderPassInfo.pSubpasses = &subpass;
-		renderPassInfo.dependencyCount = 1;
-		renderPassInfo.pDependencies = &dependency;
-
-		VkResult result = vkCreateRenderPass(device, &renderPassInfo, nullptr,
-					&renderPass);
-		if (result != VK_SUCCESS) {
-		 	PrintVkError(result);
-			throw std::runtime_error("failed to create render pass!");
-		}		
-	}
-
-    void BaseProject::createFramebuffers() {
-		swapChainFramebuffers.resize(swapChainImageViews.size());
-		for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-			std::array<VkImageView, 3> attachments = {
-				colorImageView,
-				depthImageView,
-				swapChainImageViews[i]
-			};
-
-			VkFramebufferCreateInfo framebufferInfo{};
-			framebufferInfo.sType =
-				VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-			framebufferInfo.renderPass = renderPass;
-			framebufferInfo.attachmentCount =
-							static_cast<uint32_t>(attachments.size());;
-			framebufferInfo.pAttachments = attachments.data();
-			framebufferInfo.width = swapChainExtent.width; 
-			framebufferInfo.height = swapChainExtent.height;
-			framebufferInfo.layers = 1;
-			
-			VkResult result = vkCreateFramebuffer(device, &framebufferInfo, nullptr,
-						&swapChainFramebuffers[i]);
-			if (result != VK_SUCCESS) {
-			 	PrintVkError(result);
-				throw std::runtime_error("failed to create framebuffer!");
-			}
+    void BaseProject::createRenderGraph() {
+		renderGraph.init(this, swapChainExtent,
+						 static_cast<uint32_t>(swapChainImages.size()));
+
+		// with headless an offscreen image, which may be copied to a file
+		const VkImageLayout presentLayout = headless ?
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		RenderGraph::Resource swapChainImage = renderGraph.imported("swap chain",
+				swapChainImageFormat, swapChainImages, swapChainImageViews, presentLayout);
+		RenderGraph::Resource color = renderGraph.transient("color",
+				swapChainImageFormat, msaaSamples, VK_IMAGE_ASPECT_COLOR_BIT);
+		RenderGraph::Resource depth = renderGraph.transient("depth",
+				findDepthFormat(), msaaSamples, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+		scenePass = renderGraph.addPass("scene", RenderGraph::RASTER,
+				[this](VkCommandBuffer commandBuffer, uint32_t image) {
+			recordScenePass(commandBuffer, image);
+		});
+		renderGraph.use(scenePass, color, RenderGraph::COLOR_ATTACHMENT);
+		renderGraph.use(scenePass, depth, RenderGraph::DEPTH_ATTACHMENT);
+		VkClearValue clearColor{};
+		clearColor.color = initialBackgroundColor;
+		renderGraph.clear(scenePass, color, clearColor);
+		VkClearValue clearDepth{};
+		clearDepth.depthStencil = {1.0f, 0};
+		renderGraph.clear(scenePass, depth, clearDepth);
+
+		if (!dynamicResolution) {
+			renderGraph.use(scenePass, swapChainImage, RenderGraph::RESOLVE_ATTACHMENT);
+			renderGraph.compile();
+			renderPass = renderGraph.renderPass(scenePass);
+			return;
 		}
+
+		// full size, the scale changes without creating it again
+		RenderGraph::Resource scene = renderGraph.transient("scene",
+				swapChainImageFormat, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+		renderGraph.use(scenePass, scene, RenderGraph::RESOLVE_ATTACHMENT);
+
+		RenderGraph::Pass upscalePass = renderGraph.addPass("upscale", RenderGraph::TRANSFER,
+				[this, scene, swapChainImage](VkCommandBuffer commandBuffer, uint32_t image) {
+			upscaleScene(commandBuffer, renderGraph.image(scene, image),
+					renderGraph.image(swapChainImage, image));
+		});
+		renderGraph.use(upscalePass, scene, RenderGraph::TRANSFER_SRC);
+		renderGraph.use(upscalePass, swapChainImage, RenderGraph::TRANSFER_DST);
+
+		// on the swap chain image holding the scaled scene, single sample and
+		// without depth
+		overlayPass = renderGraph.addPass("overlay", RenderGraph::RASTER,
+				[this](VkCommandBuffer commandBuffer, uint32_t image) {
+			recordOverlayPass(commandBuffer, image);
+		});
+		renderGraph.use(overlayPass, swapChainImage, RenderGraph::COLOR_ATTACHMENT);
+
+		renderGraph.compile();
+		renderPass = renderGraph.renderPass(scenePass);
+		overlayRenderPass = renderGraph.renderPass(overlayPass);
 	}
 
     void BaseProject::createCommandPool() {
@@ -783,7 +828,8 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 		VkCommandPoolCreateInfo poolInfo{};
 		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 		poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-		poolInfo.flags = 0; // Optional
+		// Command buffers are recorded again with recordEveryFrame
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 		
 		VkResult result = vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool);
 		if (result != VK_SUCCESS) {
@@ -792,35 +838,6 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 		}
 	}
 
-    void BaseProject::createColorResources() {
-		VkFormat colorFormat = swapChainImageFormat;
-		createImage(swapChainExtent.width, swapChainExtent.height, 1, 1,
-					msaaSamples, colorFormat, VK_IMAGE_TILING_OPTIMAL,
-					VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT |
-					VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 0, 
-					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-					colorImage, colorImageMemory);
-		colorImageView = createImageView(colorImage, colorFormat,
-									VK_IMAGE_ASPECT_COLOR_BIT, 1,
-									VK_IMAGE_VIEW_TYPE_2D, 1);
-	}
-
-    void BaseProject::createDepthResources() {
-		VkFormat depthFormat = findDepthFormat();
-		
-		createImage(swapChainExtent.width, swapChainExtent.height, 1, 1,
-					msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL,
-					VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0, 
-					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-					depthImage, depthImageMemory);
-		depthImageView = createImageView(depthImage, depthFormat,
-										 VK_IMAGE_ASPECT_DEPTH_BIT, 1,
-										 VK_IMAGE_VIEW_TYPE_2D, 1);
-
-		transitionImageLayout(depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED,
-							  VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1, 1);
-	}
-
     VkFormat BaseProject::findDepthFormat() {
 		return findSupportedFormat({VK_FORMAT_D32_SFLOAT,
 									VK_FORMAT_D32_SFLOAT_S8_UINT,
@@ -1146,30 +1163,37 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 	}
 
     void BaseProject::createDescriptorPool() {
-		std::array<VkDescriptorPoolSize, 2> poolSizes{};
-		poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		poolSizes[0].descriptorCount = static_cast<uint32_t>(uniformBlocksInPool *
-															 swapChainImages.size());
-		poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		poolSizes[1].descriptorCount = static_cast<uint32_t>(texturesInPool *
-															 swapChainImages.size());
-															 
-		VkDescriptorPoolCreateInfo poolInfo{};
-		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());;
-		poolInfo.pPoolSizes = poolSizes.data();
-		poolInfo.maxSets = static_cast<uint32_t>(setsInPool * swapChainImages.size());
-		
-		VkResult result = vkCreateDescriptorPool(device, &poolInfo, nullptr,
-									&descriptorPool);
-		if (result != VK_SUCCESS) {
-		 	PrintVkError(result);
-			throw std::runtime_error("failed to create descriptor pool!");
+		// Size the first pool with the requirements recorded the last time the
+		// descriptor sets were created, raised to the hints if provided
+		std::map<VkDescriptorType, uint32_t> sizes = descriptorAllocator.required;
+		uint32_t sets = descriptorAllocator.requiredSets;
+		uint32_t images = static_cast<uint32_t>(swapChainImages.size());
+		
+		sizes[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER] = std::max(
+				sizes[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER],
+				static_cast<uint32_t>(uniformBlocksInPool) * images);
+		sizes[VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER] = std::max(
+				sizes[VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER],
+				static_cast<uint32_t>(texturesInPool) * images);
+		sets = std::max(sets, static_cast<uint32_t>(setsInPool) * images);
+
+		descriptorAllocator.init(this, sizes, sets);
+
+		transientDescriptorAllocators.resize(swapChainImages.size());
+		for (auto &allocator : transientDescriptorAllocators) {
+			allocator.init(this, allocator.required, allocator.requiredSets);
 		}
 	}
 
+    VkDescriptorSet BaseProject::allocateTransientDescriptorSet(
+    		DescriptorSetLayout *L, int currentImage) {
+		VkDescriptorSet set;
+		transientDescriptorAllocators[currentImage].allocate(L, 1, &set);
+		return set;
+	}
+
     void BaseProject::createCommandBuffers() {
-    	commandBuffers.resize(swapChainFramebuffers.size());
+    	commandBuffers.resize(swapChainImages.size());
     	
     	VkCommandBufferAllocateInfo allocInfo{};
 		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1184,45 +1208,279 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 			throw std::runtime_error("failed to allocate command buffers!");
 		}
 		
+		createSecondaryCommandPools();
+		createStatisticsQueryPool();
+		createTimestampQueryPool();
+		imagesSubmitted.assign(commandBuffers.size(), false);
+
 		for (size_t i = 0; i < commandBuffers.size(); i++) {
-			VkCommandBufferBeginInfo beginInfo{};
-			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			beginInfo.flags = 0; // Optional
-			beginInfo.pInheritanceInfo = nullptr; // Optional
-
-			if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) !=
-						VK_SUCCESS) {
-				throw std::runtime_error("failed to begin recording command buffer!");
+			recordCommandBuffer(i);
+		}
+	}
+
+    void BaseProject::createStatisticsQueryPool() {
+		if (!fragmentStatistics) {
+			return;
+		}
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		poolInfo.queryCount = static_cast<uint32_t>(commandBuffers.size());
+		poolInfo.pipelineStatistics =
+				VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+		VkResult result = vkCreateQueryPool(device, &poolInfo, nullptr,
+											&statisticsQueryPool);
+		if (result != VK_SUCCESS) {
+		 	PrintVkError(result);
+			throw std::runtime_error("failed to create query pool!");
+		}
+	}
+
+    void BaseProject::createTimestampQueryPool() {
+		if (!gpuTiming) {
+			return;
+		}
+		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
+						nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
+						queueFamilies.data());
+		if (queueFamilies[indices.graphicsFamily.value()].timestampValidBits == 0) {
+			std::cout << "Timestamps not supported, no GPU timing\n";
+			gpuTiming = false;
+			return;
+		}
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		timestampPeriod = properties.limits.timestampPeriod;
+
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = static_cast<uint32_t>(2 * commandBuffers.size());
+
+		VkResult result = vkCreateQueryPool(device, &poolInfo, nullptr,
+											&timestampQueryPool);
+		if (result != VK_SUCCESS) {
+		 	PrintVkError(result);
+			throw std::runtime_error("failed to create query pool!");
+		}
+	}
+
+    void BaseProject::setViewport(VkCommandBuffer commandBuffer, VkExtent2D extent) {
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = (float) extent.width;
+		viewport.height = (float) extent.height;
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+		VkRect2D scissor{};
+		scissor.offset = {0, 0};
+		scissor.extent = extent;
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	}
+
+    void BaseProject::recordScenePass(VkCommandBuffer commandBuffer, int currentImage) {
+		if (fragmentStatistics) {
+			vkCmdResetQueryPool(commandBuffer, statisticsQueryPool, currentImage, 1);
+			vkCmdBeginQuery(commandBuffer, statisticsQueryPool, currentImage, 0);
+		}
+
+		int groups = (recordingPool != nullptr) ? commandGroups() : 0;
+		if (groups > 0) {
+			// The previous submission of this image is complete, the buffers
+			// allocated from its pools can be recorded again
+			for (auto &pool : secondaryCommandPools[currentImage]) {
+				vkResetCommandPool(device, pool.pool, 0);
+				pool.used = 0;
 			}
-			
-			VkRenderPassBeginInfo renderPassInfo{};
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			renderPassInfo.renderPass = renderPass; 
-			renderPassInfo.framebuffer = swapChainFramebuffers[i];
-			renderPassInfo.renderArea.offset = {0, 0};
-			renderPassInfo.renderArea.extent = swapChainExtent;
-	
-			std::array<VkClearValue, 2> clearValues{};
-			clearValues[0].color = initialBackgroundColor;
-			clearValues[1].depthStencil = {1.0f, 0};
-	
-			renderPassInfo.clearValueCount =
-							static_cast<uint32_t>(clearValues.size());
-			renderPassInfo.pClearValues = clearValues.data();
-			
-			vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo,
-					VK_SUBPASS_CONTENTS_INLINE);			
-	
 
-			populateCommandBuffer(commandBuffers[i], i);
-			
+			std::vector<VkCommandBuffer> secondary(groups);
+			for (int g = 0; g < groups; g++) {
+				recordingPool->submit([this, currentImage, g, &secondary]() {
+					secondary[g] = recordCommandGroup(currentImage, g);
+				});
+			}
+			recordingPool->wait();
+
+			renderGraph.begin(commandBuffer, scenePass, currentImage, renderExtent,
+					VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			vkCmdExecuteCommands(commandBuffer,
+					static_cast<uint32_t>(secondary.size()), secondary.data());
+		} else {
+			renderGraph.begin(commandBuffer, scenePass, currentImage, renderExtent,
+					VK_SUBPASS_CONTENTS_INLINE);
+			setViewport(commandBuffer, renderExtent);
+
+			populateCommandBuffer(commandBuffer, currentImage);
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+
+		if (fragmentStatistics) {
+			vkCmdEndQuery(commandBuffer, statisticsQueryPool, currentImage);
+		}
+	}
+
+    void BaseProject::upscaleScene(VkCommandBuffer commandBuffer, VkImage scene,
+								   VkImage target) {
+		VkImageBlit blit{};
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.layerCount = 1;
+		blit.srcOffsets[1] = {(int32_t)renderExtent.width, (int32_t)renderExtent.height, 1};
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.layerCount = 1;
+		blit.dstOffsets[1] = {(int32_t)swapChainExtent.width, (int32_t)swapChainExtent.height, 1};
+		vkCmdBlitImage(commandBuffer,
+				scene, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &blit, VK_FILTER_LINEAR);
+	}
+
+    void BaseProject::recordOverlayPass(VkCommandBuffer commandBuffer, int currentImage) {
+		renderGraph.begin(commandBuffer, overlayPass, currentImage, swapChainExtent,
+				VK_SUBPASS_CONTENTS_INLINE);
+		setViewport(commandBuffer, swapChainExtent);
+		populateOverlayCommands(commandBuffer, currentImage);
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+    void BaseProject::recordCommandBuffer(int currentImage) {
+		VkCommandBuffer commandBuffer = commandBuffers[currentImage];
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = 0; // Optional
+		beginInfo.pInheritanceInfo = nullptr; // Optional
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) !=
+					VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording command buffer!");
+		}
+
+		if (gpuTiming) {
+			vkCmdResetQueryPool(commandBuffer, timestampQueryPool, 2 * currentImage, 2);
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+					timestampQueryPool, 2 * currentImage);
+		}
+
+		renderExtent = swapChainExtent;
+		if (dynamicResolution) {
+			float scale = resolution.scale();
+			renderExtent.width = std::max(1u, (uint32_t)(scale * swapChainExtent.width + 0.5f));
+			renderExtent.height = std::max(1u, (uint32_t)(scale * swapChainExtent.height + 0.5f));
+		}
+		
+		populateComputeCommands(commandBuffer, currentImage);
+
+		// the scene, then with dynamicResolution its upscale and the overlay
+		renderGraph.execute(commandBuffer, currentImage);
+
+		populateFinalCommands(commandBuffer, currentImage);
+
+		if (gpuTiming) {
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+					timestampQueryPool, 2 * currentImage + 1);
+		}
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record command buffer!");
+		}
+	}
+
+    VkCommandBuffer BaseProject::recordCommandGroup(int currentImage, int group) {
+		// Each worker only uses its own pool
+		SecondaryCommandPool &pool =
+				secondaryCommandPools[currentImage][WorkStealingPool::currentWorker()];
+
+		if (pool.used == pool.buffers.size()) {
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = pool.pool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount = 1;
+
+			VkCommandBuffer buffer;
+			VkResult result = vkAllocateCommandBuffers(device, &allocInfo, &buffer);
+			if (result != VK_SUCCESS) {
+			 	PrintVkError(result);
+				throw std::runtime_error("failed to allocate secondary command buffer!");
+			}
+			pool.buffers.push_back(buffer);
+		}
+		VkCommandBuffer commandBuffer = pool.buffers[pool.used++];
+
+		VkCommandBufferInheritanceInfo inheritanceInfo{};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = renderGraph.renderPass(scenePass);
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = renderGraph.framebuffer(scenePass, currentImage);
+		if (fragmentStatistics) {
+			inheritanceInfo.pipelineStatistics =
+					VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
 
-			vkCmdEndRenderPass(commandBuffers[i]);
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording secondary command buffer!");
+		}
+
+		setViewport(commandBuffer, renderExtent);
+		populateCommandGroup(commandBuffer, currentImage, group);
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record secondary command buffer!");
+		}
+		return commandBuffer;
+	}
+
+    void BaseProject::createSecondaryCommandPools() {
+		if (recordingPool == nullptr) {
+			return;
+		}
+
+		QueueFamilyIndices queueFamilyIndices = 
+    			findQueueFamilies(physicalDevice);
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		secondaryCommandPools.resize(swapChainImages.size());
+		for (auto &imagePools : secondaryCommandPools) {
+			imagePools.resize(recordingPool->size());
+			for (auto &pool : imagePools) {
+				VkResult result = vkCreateCommandPool(device, &poolInfo, nullptr,
+													  &pool.pool);
+				if (result != VK_SUCCESS) {
+				 	PrintVkError(result);
+					throw std::runtime_error("failed to create secondary command pool!");
+				}
+				pool.buffers.clear();
+				pool.used = 0;
+			}
+		}
+	}
 
-			if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-				throw std::runtime_error("failed to record command buffer!");
+    void BaseProject::cleanupSecondaryCommandPools() {
+		// Destroying the pools also frees their command buffers
+		for (auto &imagePools : secondaryCommandPools) {
+			for (auto &pool : imagePools) {
+				vkDestroyCommandPool(device, pool.pool, nullptr);
 			}
 		}
+		secondaryCommandPools.clear();
 	}
 
     void BaseProject::createSyncObjects() {
@@ -1257,50 +1515,101 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
     }
 
     void BaseProject::mainLoop() {
-        while (!glfwWindowShouldClose(window)){
-            glfwPollEvents();
-            drawFrame();
-        }
+		if (headless) {
+			while (frameNumber < headlessFrames && !closeRequested) {
+				drawFrame();
+			}
+		} else {
+			while (!glfwWindowShouldClose(window)){
+				glfwPollEvents();
+				drawFrame();
+			}
+		}
         
         vkDeviceWaitIdle(device);
     }
 
     void BaseProject::drawFrame() {
+		auto frameStart = std::chrono::steady_clock::now();
 		vkWaitForFences(device, 1, &inFlightFences[currentFrame],
 						VK_TRUE, UINT64_MAX);
+		auto fenceEnd = std::chrono::steady_clock::now();
+		double fenceWait = std::chrono::duration<double>(fenceEnd - frameStart).count();
 		
 		uint32_t imageIndex;
+		VkResult result;
 		
-		VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX,
-				imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-
-		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-			recreateSwapChain();
-			return;
-		} else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-			throw std::runtime_error("failed to acquire swap chain image!");
+		if (headless) {
+			// one offscreen image for each frame in flight
+			imageIndex = static_cast<uint32_t>(currentFrame);
+		} else {
+			result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX,
+					imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+
+			if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+				recreateSwapChain();
+				return;
+			} else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+				throw std::runtime_error("failed to acquire swap chain image!");
+			}
 		}
 
 		if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+			auto waitStart = std::chrono::steady_clock::now();
 			vkWaitForFences(device, 1, &imagesInFlight[imageIndex],
 							VK_TRUE, UINT64_MAX);
+			fenceWait += std::chrono::duration<double>(
+					std::chrono::steady_clock::now() - waitStart).count();
 		}
 		imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+
+		// the last submission of the image is complete: no need to wait
+		if (fragmentStatistics && imagesSubmitted[imageIndex]) {
+			uint64_t invocations;
+			if (vkGetQueryPoolResults(device, statisticsQueryPool, imageIndex, 1,
+						sizeof(invocations), &invocations, sizeof(invocations),
+						VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+				fragmentInvocations = invocations;
+			}
+		}
+		double gpuTime = -1.0;
+		if (gpuTiming && imagesSubmitted[imageIndex]) {
+			uint64_t timestamps[2];
+			if (vkGetQueryPoolResults(device, timestampQueryPool, 2 * imageIndex, 2,
+						sizeof(timestamps), timestamps, sizeof(uint64_t),
+						VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+				gpuFrameTime = (timestamps[1] - timestamps[0]) * timestampPeriod * 1e-9;
+				gpuTime = gpuFrameTime;
+				if (dynamicResolution) {
+					resolution.update((float)gpuFrameTime);
+				}
+			}
+		}
+
+		// The last frame which used this image is done with its sets
+		transientDescriptorAllocators[imageIndex].reset();
 		
 		updateUniformBuffer(imageIndex);
+
+		if (recordEveryFrame) {
+			recordCommandBuffer(imageIndex);
+		}
 		
 		VkSubmitInfo submitInfo{};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 		VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
+		// with dynamicResolution the image is first written by the blit
 		VkPipelineStageFlags waitStages[] =
-			{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-		submitInfo.waitSemaphoreCount = 1;
+			{dynamicResolution ? VK_PIPELINE_STAGE_TRANSFER_BIT :
+								 VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+		// the offscreen images are neither acquired nor presented
+		submitInfo.waitSemaphoreCount = headless ? 0 : 1;
 		submitInfo.pWaitSemaphores = waitSemaphores;
 		submitInfo.pWaitDstStageMask = waitStages;
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
 		VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.signalSemaphoreCount = headless ? 0 : 1;
 		submitInfo.pSignalSemaphores = signalSemaphores;
 		
 		vkResetFences(device, 1, &inFlightFences[currentFrame]);
@@ -1309,6 +1618,23 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 				inFlightFences[currentFrame]) != VK_SUCCESS) {
 			throw std::runtime_error("failed to submit draw command buffer!");
 		}
+		imagesSubmitted[imageIndex] = true;
+
+		if (recordFrameStats) {
+			// the present may block as well, the CPU time ends here
+			double total = std::chrono::duration<double>(
+					std::chrono::steady_clock::now() - frameStart).count();
+			frameStats.add({total - fenceWait, fenceWait, gpuTime});
+		}
+
+		if (headless) {
+			if (captureFrames.count(frameNumber)) {
+				saveImage(imageIndex, capturePrefix + std::to_string(frameNumber) + ".png");
+			}
+			frameNumber++;
+			currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+			return;
+		}
 		
 		VkPresentInfoKHR presentInfo{};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -1331,9 +1657,53 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
             throw std::runtime_error("failed to present swap chain image!");
         }
 		
+		frameNumber++;
 		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
     }
 
+    void BaseProject::saveImage(uint32_t imageIndex, const std::string &file) {
+		vkWaitForFences(device, 1, &imagesInFlight[imageIndex],
+						VK_TRUE, UINT64_MAX);
+
+		VkDeviceSize rowSize = swapChainExtent.width * 4;
+		VkDeviceSize imageSize = rowSize * swapChainExtent.height;
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+						VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+						VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+						stagingBuffer, stagingBufferMemory);
+
+		// left in TRANSFER_SRC_OPTIMAL by the render pass
+		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		VkBufferImageCopy region{};
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = {swapChainExtent.width, swapChainExtent.height, 1};
+		vkCmdCopyImageToBuffer(commandBuffer, swapChainImages[imageIndex],
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, stagingBuffer, 1, &region);
+		endSingleTimeCommands(commandBuffer);
+
+		void* data;
+		vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
+		stbi_uc *pixels = static_cast<stbi_uc*>(data);
+		// the alpha written by the blending is not a coverage
+		for (VkDeviceSize i = 3; i < imageSize; i += 4) {
+			pixels[i] = 255;
+		}
+		int written = stbi_write_png(file.c_str(), swapChainExtent.width,
+						swapChainExtent.height, 4, pixels, (int)rowSize);
+		vkUnmapMemory(device, stagingBufferMemory);
+
+		vkDestroyBuffer(device, stagingBuffer, nullptr);
+		vkFreeMemory(device, stagingBufferMemory, nullptr);
+
+		if (!written) {
+			throw std::runtime_error("failed to write " + file + "!");
+		}
+		std::cout << "Frame " << frameNumber << " saved to " << file << "\n";
+	}
+
     void BaseProject::recreateSwapChain() {
     	int width = 0, height = 0;
 		glfwGetFramebufferSize(window, &width, &height);
@@ -1349,10 +1719,7 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 
 		createSwapChain();
 		createImageViews();
-		createRenderPass();
-		createColorResources();
-		createDepthResources();
-		createFramebuffers();
+		createRenderGraph();
 		createDescriptorPool();
 
 		pipelinesAndDescriptorSetsInit();
@@ -1361,38 +1728,47 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 	}
 
     void BaseProject::cleanupSwapChain() {
-    	vkDestroyImageView(device, colorImageView, nullptr);
-    	vkDestroyImage(device, colorImage, nullptr);
-    	vkFreeMemory(device, colorImageMemory, nullptr);
-    	
-		vkDestroyImageView(device, depthImageView, nullptr);
-		vkDestroyImage(device, depthImage, nullptr);
-		vkFreeMemory(device, depthImageMemory, nullptr);
-
-		for (size_t i = 0; i < swapChainFramebuffers.size(); i++) {
-			vkDestroyFramebuffer(device, swapChainFramebuffers[i], nullptr);
-		}
-		
 		vkFreeCommandBuffers(device, commandPool,
 				static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+		cleanupSecondaryCommandPools();
+		if (statisticsQueryPool != VK_NULL_HANDLE) {
+			vkDestroyQueryPool(device, statisticsQueryPool, nullptr);
+			statisticsQueryPool = VK_NULL_HANDLE;
+		}
+		if (timestampQueryPool != VK_NULL_HANDLE) {
+			vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+			timestampQueryPool = VK_NULL_HANDLE;
+		}
 				
 		pipelinesAndDescriptorSetsCleanup();
 
-		vkDestroyRenderPass(device, renderPass, nullptr);
+		renderGraph.cleanup();
 
 		for (size_t i = 0; i < swapChainImageViews.size(); i++){
 			vkDestroyImageView(device, swapChainImageViews[i], nullptr);
 		}
 		
-		vkDestroySwapchainKHR(device, swapChain, nullptr);
+		if (headless) {
+			for (size_t i = 0; i < swapChainImages.size(); i++) {
+				vkDestroyImage(device, swapChainImages[i], nullptr);
+				vkFreeMemory(device, offscreenImageMemory[i], nullptr);
+			}
+		} else {
+			vkDestroySwapchainKHR(device, swapChain, nullptr);
+		}
 
-		vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+		descriptorAllocator.cleanup();
+		for (auto &allocator : transientDescriptorAllocators) {
+			allocator.cleanup();
+		}
 	}
 
     void BaseProject::cleanup() {
 		cleanupSwapChain();
     	 	
 		localCleanup();
+
+		samplerCache.cleanup();
     	
     	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 			vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
@@ -1401,17 +1777,29 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
     	}
     	
     	vkDestroyCommandPool(device, commandPool, nullptr);
+
+		delete recordingPool;
+		recordingPool = nullptr;
+
+		delete inputRecorder;
+		inputRecorder = nullptr;
+		delete inputReplay;
+		inputReplay = nullptr;
     	
  		vkDestroyDevice(device, nullptr);
 		
 		DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
 		
-		vkDestroySurfaceKHR(instance, surface, nullptr);
+		if (!headless) {
+			vkDestroySurfaceKHR(instance, surface, nullptr);
+		}
     	vkDestroyInstance(instance, nullptr);
 
-        glfwDestroyWindow(window);
+		if (!headless) {
+			glfwDestroyWindow(window);
 
-        glfwTerminate();
+			glfwTerminate();
+		}
     }
 
     // Control Wrapper
@@ -1448,21 +1836,50 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 	}
 
     void BaseProject::getSixAxis(float &deltaT, glm::vec3 &m, glm::vec3 &r, bool &fire) {
-		static auto startTime = std::chrono::high_resolution_clock::now();
-		static float lastTime = 0.0f;
-		
 		auto currentTime = std::chrono::high_resolution_clock::now();
+		if(!controls.started) {
+			controls.startTime = currentTime;
+			if(!headless) {
+				glfwGetCursorPos(window, &controls.old_xpos, &controls.old_ypos);
+			}
+			controls.started = true;
+		}
 		float time = std::chrono::duration<float, std::chrono::seconds::period>
-					(currentTime - startTime).count();
-		deltaT = time - lastTime;
-		lastTime = time;
+					(currentTime - controls.startTime).count();
+		deltaT = time - controls.lastTime;
+		controls.lastTime = time;
+		if(headless) {
+			// the same frames whatever the speed of the device
+			deltaT = replayDeltaT > 0.0f ? replayDeltaT : 1.0f / 60.0f;
+		}
+
+		if(inputReplay) {
+			InputFrame frame;
+			if(!inputReplay->read(frame)) {
+				// log over: idle until the window closes
+				if(headless) {
+					closeRequested = true;
+				} else {
+					glfwSetWindowShouldClose(window, GLFW_TRUE);
+				}
+				frame.deltaT = deltaT;
+			}
+			deltaT = replayDeltaT > 0.0f ? replayDeltaT : frame.deltaT;
+			m = frame.m;
+			r = frame.r;
+			fire = frame.fire;
+			return;
+		}
+		if(headless) {
+			// no controllers
+			return;
+		}
 
-		static double old_xpos = 0, old_ypos = 0;
 		double xpos, ypos;
 		glfwGetCursorPos(window, &xpos, &ypos);
-		double m_dx = xpos - old_xpos;
-		double m_dy = ypos - old_ypos;
-		old_xpos = xpos; old_ypos = ypos;
+		double m_dx = xpos - controls.old_xpos;
+		double m_dy = ypos - controls.old_ypos;
+		controls.old_xpos = xpos; controls.old_ypos = ypos;
 
 		const float MOUSE_RES = 10.0f;				
 		glfwSetInputMode(window, GLFW_STICKY_MOUSE_BUTTONS, GLFW_TRUE);
@@ -1514,6 +1931,15 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 		handleGamePad(GLFW_JOYSTICK_2,m,r,fire);
 		handleGamePad(GLFW_JOYSTICK_3,m,r,fire);
 		handleGamePad(GLFW_JOYSTICK_4,m,r,fire);
+
+		if(inputRecorder) {
+			InputFrame frame;
+			frame.deltaT = deltaT;
+			frame.m = m;
+			frame.r = r;
+			frame.fire = fire;
+			inputRecorder->write(frame);
+		}
 	}
 
     void VertexDescriptor::init(BaseProject *bp, std::vector<VertexBindingDescriptorElement> B, std::vector<VertexDescriptorElement> E) {
@@ -1594,7 +2020,7 @@ bool BaseProject::checkIfItHasExtension(const char *ext) {
 			    break;
 			}
 		}
-	} else {
+	} else if(B.size() > 1) {
 		throw std::runtime_error("Vertex format with more than one binding is not supported yet\n");
 	}
 }
@@ -1654,8 +2080,15 @@ void Texture::createTextureImage(const char *const files[], VkFormat Fmt = VK_FO
 		}
 	}
 	
-	VkDeviceSize imageSize = texWidth * texHeight * 4;
-	VkDeviceSize totalImageSize = texWidth * texHeight * 4 * imgs;
+	uploadTextureImage(pixels, texWidth, texHeight, Fmt);
+	for(int i = 0; i < imgs; i++) {
+		stbi_image_free(pixels[i]);
+	}
+}
+
+void Texture::uploadTextureImage(stbi_uc *const pixels[], int texWidth, int texHeight, VkFormat Fmt) {
+	VkDeviceSize imageSize = (VkDeviceSize)texWidth * texHeight * 4;
+	VkDeviceSize totalImageSize = imageSize * imgs;
 	mipLevels = static_cast<uint32_t>(std::floor(
 					std::log2(std::max(texWidth, texHeight)))) + 1;
 	
@@ -1670,7 +2103,6 @@ void Texture::createTextureImage(const char *const files[], VkFormat Fmt = VK_FO
 	vkMapMemory(BP->device, stagingBufferMemory, 0, totalImageSize, 0, &data);
 	for(int i = 0; i < imgs; i++) {
 		memcpy(static_cast<char *>(data) + imageSize * i, pixels[i], static_cast<size_t>(imageSize));
-		stbi_image_free(pixels[i]);
 	}
 	vkUnmapMemory(BP->device, stagingBufferMemory);
 	
@@ -1729,14 +2161,11 @@ void Texture::createTextureSampler(
 	samplerInfo.mipmapMode = mipmapMode;
 	samplerInfo.mipLodBias = 0.0f;
 	samplerInfo.minLod = 0.0f;
-	samplerInfo.maxLod = ((maxLod == -1) ? static_cast<float>(mipLevels) : maxLod);
+	// unless asked otherwise the view limits the mip levels, so textures
+	// with different mip counts share the same cached sampler
+	samplerInfo.maxLod = ((maxLod == -1) ? VK_LOD_CLAMP_NONE : maxLod);
 	
-	VkResult result = vkCreateSampler(BP->device, &samplerInfo, nullptr,
-									  &textureSampler);
-	if (result != VK_SUCCESS) {
-	 	PrintVkError(result);
-	 	throw std::runtime_error("failed to create texture sampler!");
-	}
+	textureSampler = BP->samplerCache.acquire(BP, samplerInfo);
 }
 	
 
@@ -1745,6 +2174,7 @@ void Texture::init(BaseProject *bp, const char *  file, VkFormat Fmt, bool initS
 	const char *files[1] = {file};
 	BP = bp;
 	imgs = 1;
+	textureSampler = VK_NULL_HANDLE;
 	createTextureImage(files, Fmt);
 	createTextureImageView(Fmt);
 	if(initSampler) {
@@ -1761,9 +2191,98 @@ void Texture::initCubic(BaseProject *bp, const char * files[6]) {
 	createTextureSampler();
 }
 
+// Direction through the texel (u, v) in [-1, 1] of a face of a cube map,
+// faces in the order and orientation of the Vulkan cube map layers
+static glm::vec3 cubeFaceDirection(int face, float u, float v) {
+	switch(face) {
+	  case 0: return glm::vec3(1.0f, -v, -u);
+	  case 1: return glm::vec3(-1.0f, -v, u);
+	  case 2: return glm::vec3(u, 1.0f, v);
+	  case 3: return glm::vec3(u, -1.0f, -v);
+	  case 4: return glm::vec3(u, -v, 1.0f);
+	  default: return glm::vec3(-u, -v, -1.0f);
+	}
+}
+
+// Bilinear sample of an RGBA equirectangular image, with the mapping of the
+// UVs of Sphere.gltf: u = 0.5 - atan(z, x) / 2pi, v = acos(y) / pi
+static void sampleEquirect(const stbi_uc *src, int w, int h, glm::vec3 dir, stbi_uc *out) {
+	dir = glm::normalize(dir);
+	float u = 0.5f - std::atan2(dir.z, dir.x) / (2.0f * glm::pi<float>());
+	float v = std::acos(glm::clamp(dir.y, -1.0f, 1.0f)) / glm::pi<float>();
+	float x = u * w - 0.5f;
+	float y = glm::clamp(v * h - 0.5f, 0.0f, (float)(h - 1));
+	int x0 = (int)std::floor(x);
+	int y0 = (int)y;
+	float fx = x - x0, fy = y - y0;
+	// the longitude wraps around, the latitude does not
+	x0 = ((x0 % w) + w) % w;
+	int x1 = (x0 + 1) % w;
+	int y1 = std::min(y0 + 1, h - 1);
+	for(int c = 0; c < 4; c++) {
+		float top = src[(y0 * w + x0) * 4 + c] * (1.0f - fx) + src[(y0 * w + x1) * 4 + c] * fx;
+		float bottom = src[(y1 * w + x0) * 4 + c] * (1.0f - fx) + src[(y1 * w + x1) * 4 + c] * fx;
+		out[c] = (stbi_uc)(top * (1.0f - fy) + bottom * fy + 0.5f);
+	}
+}
+
+void Texture::initEquirect(BaseProject *bp, const char * file, int faceSize, VkFormat Fmt) {
+	BP = bp;
+	imgs = 6;
+	textureSampler = VK_NULL_HANDLE;
+
+	int texWidth, texHeight, texChannels;
+	stbi_uc *src = stbi_load(file, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+	if (!src) {
+		std::cout << "Not found: " << file << "\n";
+		throw std::runtime_error("failed to load texture image!");
+	}
+	if(faceSize <= 0) {
+		faceSize = std::max(1, texWidth / 4);
+	}
+	std::cout << file << " -> size: " << texWidth << "x" << texHeight
+			  << ", cube faces: " << faceSize << "x" << faceSize << "\n";
+
+	// the faces are independent, one task each on the recording pool
+	std::vector<std::vector<stbi_uc>> faces(6,
+			std::vector<stbi_uc>((size_t)faceSize * faceSize * 4));
+	auto convert = [&](int face) {
+		for(int y = 0; y < faceSize; y++) {
+			for(int x = 0; x < faceSize; x++) {
+				glm::vec3 dir = cubeFaceDirection(face,
+						2.0f * (x + 0.5f) / faceSize - 1.0f,
+						2.0f * (y + 0.5f) / faceSize - 1.0f);
+				sampleEquirect(src, texWidth, texHeight, dir,
+						&faces[face][((size_t)y * faceSize + x) * 4]);
+			}
+		}
+	};
+	if(BP->recordingPool != nullptr) {
+		for(int face = 0; face < 6; face++) {
+			BP->recordingPool->submit([&convert, face]() { convert(face); });
+		}
+		BP->recordingPool->wait();
+	} else {
+		for(int face = 0; face < 6; face++) {
+			convert(face);
+		}
+	}
+	stbi_image_free(src);
+
+	stbi_uc *pixels[6];
+	for(int face = 0; face < 6; face++) {
+		pixels[face] = faces[face].data();
+	}
+	uploadTextureImage(pixels, faceSize, faceSize, Fmt);
+	createTextureImageView(Fmt);
+	createTextureSampler();
+}
+
 
 void Texture::cleanup() {
-   	vkDestroySampler(BP->device, textureSampler, nullptr);
+	if(textureSampler != VK_NULL_HANDLE) {
+		BP->samplerCache.release(textureSampler);
+	}
    	vkDestroyImageView(BP->device, textureImageView, nullptr);
 	vkDestroyImage(BP->device, textureImage, nullptr);
 	vkFreeMemory(BP->device, textureImageMemory, nullptr);
@@ -1773,23 +2292,90 @@ void Texture::cleanup() {
 
 
 
-void Pipeline::init(BaseProject *bp, VertexDescriptor *vd,
-					const std::string& VertShader, const std::string& FragShader,
-					std::vector<DescriptorSetLayout *> d) {
-	BP = bp;
-	VD = vd;
-	
-	auto vertShaderCode = readFile(VertShader);
-	auto fragShaderCode = readFile(FragShader);
-	std::cout << "Vertex shader <" << VertShader << "> len: " << 
-				vertShaderCode.size() << "\n";
-	std::cout << "Fragment shader <" << FragShader << "> len: " <<
-				fragShaderCode.size() << "\n";
-	
-	vertShaderModule =
-			createShaderModule(vertShaderCode);
-	fragShaderModule =
-			createShaderModule(fragShaderCode);
+SamplerKey::SamplerKey(const VkSamplerCreateInfo &info) {
+	flags = info.flags;
+	magFilter = info.magFilter;
+	minFilter = info.minFilter;
+	mipmapMode = info.mipmapMode;
+	addressModeU = info.addressModeU;
+	addressModeV = info.addressModeV;
+	addressModeW = info.addressModeW;
+	mipLodBias = info.mipLodBias;
+	anisotropyEnable = info.anisotropyEnable;
+	maxAnisotropy = info.maxAnisotropy;
+	compareEnable = info.compareEnable;
+	compareOp = info.compareOp;
+	minLod = info.minLod;
+	maxLod = info.maxLod;
+	borderColor = info.borderColor;
+	unnormalizedCoordinates = info.unnormalizedCoordinates;
+}
+
+bool SamplerKey::operator<(const SamplerKey &o) const {
+	return std::tie(flags, magFilter, minFilter, mipmapMode,
+					addressModeU, addressModeV, addressModeW, mipLodBias,
+					anisotropyEnable, maxAnisotropy, compareEnable, compareOp,
+					minLod, maxLod, borderColor, unnormalizedCoordinates) <
+		   std::tie(o.flags, o.magFilter, o.minFilter, o.mipmapMode,
+					o.addressModeU, o.addressModeV, o.addressModeW, o.mipLodBias,
+					o.anisotropyEnable, o.maxAnisotropy, o.compareEnable, o.compareOp,
+					o.minLod, o.maxLod, o.borderColor, o.unnormalizedCoordinates);
+}
+
+VkSampler SamplerCache::acquire(BaseProject *bp, const VkSamplerCreateInfo &info) {
+	BP = bp;
+	SamplerKey key(info);
+
+	auto it = samplers.find(key);
+	if(it != samplers.end()) {
+		it->second.refs++;
+		return it->second.sampler;
+	}
+
+	VkSampler sampler;
+	VkResult result = vkCreateSampler(BP->device, &info, nullptr, &sampler);
+	if (result != VK_SUCCESS) {
+	 	PrintVkError(result);
+	 	throw std::runtime_error("failed to create texture sampler!");
+	}
+	samplers.emplace(key, Entry{sampler, 1});
+	return sampler;
+}
+
+void SamplerCache::release(VkSampler sampler) {
+	for(auto it = samplers.begin(); it != samplers.end(); it++) {
+		if(it->second.sampler == sampler) {
+			if(--it->second.refs == 0) {
+				vkDestroySampler(BP->device, sampler, nullptr);
+				samplers.erase(it);
+			}
+			return;
+		}
+	}
+}
+
+void SamplerCache::cleanup() {
+	if(!samplers.empty()) {
+		std::cout << "Destroying " << samplers.size()
+				  << " samplers still in use\n";
+	}
+	for(auto &entry : samplers) {
+		vkDestroySampler(BP->device, entry.second.sampler, nullptr);
+	}
+	samplers.clear();
+}
+
+void Pipeline::init(BaseProject *bp, VertexDescriptor *vd,
+					const std::string& VertShader, const std::string& FragShader,
+					std::vector<DescriptorSetLayout *> d) {
+	BP = bp;
+	VD = vd;
+	overlay = false;
+	specEntries.clear();
+	specData.clear();
+	
+	vertShaderModule = loadShaderModule(BP, VertShader, "Vertex");
+	fragShaderModule = loadShaderModule(BP, FragShader, "Fragment");
 
  	compareOp = VK_COMPARE_OP_LESS;
  	polyModel = VK_POLYGON_MODE_FILL;
@@ -1823,6 +2409,16 @@ void Pipeline::create() {
     fragShaderStageInfo.module = fragShaderModule;
     fragShaderStageInfo.pName = "main";
 
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = static_cast<uint32_t>(specEntries.size());
+	specializationInfo.pMapEntries = specEntries.data();
+	specializationInfo.dataSize = specData.size();
+	specializationInfo.pData = specData.data();
+	if (!specEntries.empty()) {
+		vertShaderStageInfo.pSpecializationInfo = &specializationInfo;
+		fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
+	}
+
     VkPipelineShaderStageCreateInfo shaderStages[] =
     		{vertShaderStageInfo, fragShaderStageInfo};
 
@@ -1845,25 +2441,27 @@ void Pipeline::create() {
 	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 	inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float) BP->swapChainExtent.width;
-	viewport.height = (float) BP->swapChainExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-	
-	VkRect2D scissor{};
-	scissor.offset = {0, 0};
-	scissor.extent = BP->swapChainExtent;
-	
+	// Set by BaseProject::setViewport, the scene may be drawn on a part of
+	// the framebuffer
 	VkPipelineViewportStateCreateInfo viewportState{};
 	viewportState.sType =
 			VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
+	viewportState.pViewports = nullptr;
 	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
+	viewportState.pScissors = nullptr;
+
+	VkDynamicState dynamicStates[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	// the overlay pass is single sample
+	bool overlayPass = overlay && BP->dynamicResolution;
 	
 	VkPipelineRasterizationStateCreateInfo rasterizer{};
 	rasterizer.sType =
@@ -1882,8 +2480,8 @@ void Pipeline::create() {
 	VkPipelineMultisampleStateCreateInfo multisampling{};
 	multisampling.sType =
 			VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampling.sampleShadingEnable = VK_TRUE;
-	multisampling.rasterizationSamples = BP->msaaSamples;
+	multisampling.sampleShadingEnable = overlayPass ? VK_FALSE : VK_TRUE;
+	multisampling.rasterizationSamples = overlayPass ? VK_SAMPLE_COUNT_1_BIT : BP->msaaSamples;
 	multisampling.minSampleShading = 1.0f; // Optional
 	multisampling.pSampleMask = nullptr; // Optional
 	multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
@@ -1966,9 +2564,9 @@ void Pipeline::create() {
 	pipelineInfo.pMultisampleState = &multisampling;
 	pipelineInfo.pDepthStencilState = &depthStencil;
 	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.pDynamicState = nullptr; // Optional
+	pipelineInfo.pDynamicState = &dynamicState;
 	pipelineInfo.layout = pipelineLayout;
-	pipelineInfo.renderPass = BP->renderPass;
+	pipelineInfo.renderPass = overlayPass ? BP->overlayRenderPass : BP->renderPass;
 	pipelineInfo.subpass = 0;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
 	pipelineInfo.basePipelineIndex = -1; // Optional
@@ -2012,7 +2610,11 @@ std::vector<char> Pipeline::readFile(const std::string& filename) {
 	return buffer;
 }
 
-VkShaderModule Pipeline::createShaderModule(const std::vector<char>& code) {
+VkShaderModule Pipeline::loadShaderModule(BaseProject *bp, const std::string& file,
+										   const char *stage) {
+	auto code = readFile(file);
+	std::cout << stage << " shader <" << file << "> len: " << code.size() << "\n";
+
 	VkShaderModuleCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 	createInfo.codeSize = code.size();
@@ -2020,7 +2622,7 @@ VkShaderModule Pipeline::createShaderModule(const std::vector<char>& code) {
 	
 	VkShaderModule shaderModule;
 
-	VkResult result = vkCreateShaderModule(BP->device, &createInfo, nullptr,
+	VkResult result = vkCreateShaderModule(bp->device, &createInfo, nullptr,
 					&shaderModule);
 	if (result != VK_SUCCESS) {
 	 	PrintVkError(result);
@@ -2035,23 +2637,101 @@ void Pipeline::cleanup() {
 		vkDestroyPipelineLayout(BP->device, pipelineLayout, nullptr);
 }
 
+void ComputePipeline::init(BaseProject *bp, const std::string& CompShader,
+						   std::vector<DescriptorSetLayout *> d, uint32_t _pushConstantSize) {
+	BP = bp;
+	pushConstantSize = _pushConstantSize;
+
+	compShaderModule = Pipeline::loadShaderModule(BP, CompShader, "Compute");
+
+	D = d;
+}
+
+void ComputePipeline::create() {
+	VkPipelineShaderStageCreateInfo compShaderStageInfo{};
+	compShaderStageInfo.sType =
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	compShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	compShaderStageInfo.module = compShaderModule;
+	compShaderStageInfo.pName = "main";
+
+	std::vector<VkDescriptorSetLayout> DSL(D.size());
+	for(int i = 0; i < D.size(); i++) {
+		DSL[i] = D[i]->descriptorSetLayout;
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType =
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = DSL.size();
+	pipelineLayoutInfo.pSetLayouts = DSL.data();
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = pushConstantSize;
+	pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges = pushConstantSize > 0 ? &pushConstantRange : nullptr;
+
+	VkResult result = vkCreatePipelineLayout(BP->device, &pipelineLayoutInfo, nullptr,
+				&pipelineLayout);
+	if (result != VK_SUCCESS) {
+	 	PrintVkError(result);
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = compShaderStageInfo;
+	pipelineInfo.layout = pipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	result = vkCreateComputePipelines(BP->device, VK_NULL_HANDLE, 1,
+			&pipelineInfo, nullptr, &computePipeline);
+	if (result != VK_SUCCESS) {
+	 	PrintVkError(result);
+		throw std::runtime_error("failed to create compute pipeline!");
+	}
+}
+
+void ComputePipeline::destroy() {
+	vkDestroyShaderModule(BP->device, compShaderModule, nullptr);
+}
+
+void ComputePipeline::bind(VkCommandBuffer commandBuffer) {
+	vkCmdBindPipeline(commandBuffer,
+					  VK_PIPELINE_BIND_POINT_COMPUTE,
+					  computePipeline);
+}
+
+void ComputePipeline::push(VkCommandBuffer commandBuffer, const void *data) {
+	vkCmdPushConstants(commandBuffer, pipelineLayout,
+					   VK_SHADER_STAGE_COMPUTE_BIT, 0, pushConstantSize, data);
+}
+
+void ComputePipeline::cleanup() {
+		vkDestroyPipeline(BP->device, computePipeline, nullptr);
+		vkDestroyPipelineLayout(BP->device, pipelineLayout, nullptr);
+}
+
 void DescriptorSetLayout::init(BaseProject *bp, std::vector<DescriptorSetLayoutBinding> B) {
 	BP = bp;
+	bindings = B;
 	
-	std::vector<VkDescriptorSetLayoutBinding> bindings;
-	bindings.resize(B.size());
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+	layoutBindings.resize(B.size());
 	for(int i = 0; i < B.size(); i++) {
-		bindings[i].binding = B[i].binding;
-		bindings[i].descriptorType = B[i].type;
-		bindings[i].descriptorCount = 1;
-		bindings[i].stageFlags = B[i].flags;
-		bindings[i].pImmutableSamplers = nullptr;
+		layoutBindings[i].binding = B[i].binding;
+		layoutBindings[i].descriptorType = B[i].type;
+		layoutBindings[i].descriptorCount = 1;
+		layoutBindings[i].stageFlags = B[i].flags;
+		layoutBindings[i].pImmutableSamplers = nullptr;
 	}
 	
 	VkDescriptorSetLayoutCreateInfo layoutInfo{};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());;
-	layoutInfo.pBindings = bindings.data();
+	layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());;
+	layoutInfo.pBindings = layoutBindings.data();
 	
 	VkResult result = vkCreateDescriptorSetLayout(BP->device, &layoutInfo,
 								nullptr, &descriptorSetLayout);
@@ -2076,10 +2756,17 @@ void DescriptorSet::init(BaseProject *bp, DescriptorSetLayout *DSL,
 	for (int j = 0; j < E.size(); j++) {
 		uniformBuffers[j].resize(BP->swapChainImages.size());
 		uniformBuffersMemory[j].resize(BP->swapChainImages.size());
-		if(E[j].type == UNIFORM) {
+		if(E[j].type != TEXTURE) {
+			VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+			if(E[j].type == STORAGE) {
+				usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+			} else if(E[j].type == INDIRECT) {
+				usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+						VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+			}
 			for (size_t i = 0; i < BP->swapChainImages.size(); i++) {
 				VkDeviceSize bufferSize = E[j].size;
-				BP->createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				BP->createBuffer(bufferSize, usage,
 									 	 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
 									 	 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 									 	 uniformBuffers[j][i], uniformBuffersMemory[j][i]);
@@ -2090,29 +2777,17 @@ void DescriptorSet::init(BaseProject *bp, DescriptorSetLayout *DSL,
 		}
 	}
 	
-	std::vector<VkDescriptorSetLayout> layouts(BP->swapChainImages.size(),
-											   DSL->descriptorSetLayout);
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = BP->descriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(BP->swapChainImages.size());
-	allocInfo.pSetLayouts = layouts.data();
-	
 	descriptorSets.resize(BP->swapChainImages.size());
-	
-	VkResult result = vkAllocateDescriptorSets(BP->device, &allocInfo,
-										descriptorSets.data());
-	if (result != VK_SUCCESS) {
-		PrintVkError(result);
-		throw std::runtime_error("failed to allocate descriptor sets!");
-	}
+	BP->descriptorAllocator.allocate(DSL,
+						static_cast<uint32_t>(BP->swapChainImages.size()),
+						descriptorSets.data());
 	
 	for (size_t i = 0; i < BP->swapChainImages.size(); i++) {
 		std::vector<VkWriteDescriptorSet> descriptorWrites(E.size());
 		std::vector<VkDescriptorBufferInfo> bufferInfo(E.size());
 		std::vector<VkDescriptorImageInfo> imageInfo(E.size());
 		for (int j = 0; j < E.size(); j++) {
-			if(E[j].type == UNIFORM) {
+			if(E[j].type != TEXTURE) {
 				bufferInfo[j].buffer = uniformBuffers[j][i];
 				bufferInfo[j].offset = 0;
 				bufferInfo[j].range = E[j].size;
@@ -2121,7 +2796,9 @@ void DescriptorSet::init(BaseProject *bp, DescriptorSetLayout *DSL,
 				descriptorWrites[j].dstSet = descriptorSets[i];
 				descriptorWrites[j].dstBinding = E[j].binding;
 				descriptorWrites[j].dstArrayElement = 0;
-				descriptorWrites[j].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				descriptorWrites[j].descriptorType = E[j].type == UNIFORM ?
+											VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER :
+											VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 				descriptorWrites[j].descriptorCount = 1;
 				descriptorWrites[j].pBufferInfo = &bufferInfo[j];
 			} else if(E[j].type == TEXTURE) {
@@ -2164,6 +2841,14 @@ void DescriptorSet::bind(VkCommandBuffer commandBuffer, Pipeline &P, int setId,
 					0, nullptr);
 }
 
+void DescriptorSet::bind(VkCommandBuffer commandBuffer, ComputePipeline &P, int setId,
+						 int currentImage) {
+	vkCmdBindDescriptorSets(commandBuffer,
+					VK_PIPELINE_BIND_POINT_COMPUTE,
+					P.pipelineLayout, setId, 1, &descriptorSets[currentImage],
+					0, nullptr);
+}
+
 void DescriptorSet::map(int currentImage, void *src, int size, int slot) {
 	void* data;
 
@@ -2172,3 +2857,796 @@ void DescriptorSet::map(int currentImage, void *src, int size, int slot) {
 	memcpy(data, src, size);
 	vkUnmapMemory(BP->device, uniformBuffersMemory[slot][currentImage]);	
 }
+
+void DescriptorSet::read(int currentImage, void *dst, int size, int slot) {
+	void* data;
+
+	vkMapMemory(BP->device, uniformBuffersMemory[slot][currentImage], 0,
+						size, 0, &data);
+	memcpy(dst, data, size);
+	vkUnmapMemory(BP->device, uniformBuffersMemory[slot][currentImage]);	
+}
+
+
+void DescriptorAllocator::init(BaseProject *bp,
+							   std::map<VkDescriptorType, uint32_t> sizes,
+							   uint32_t sets) {
+	BP = bp;
+	required.clear();
+	requiredSets = 0;
+	// Without any requirement the first pool is created by the first allocation
+	if(sets > 0) {
+		createPool(sizes, sets);
+	}
+}
+
+void DescriptorAllocator::createPool(std::map<VkDescriptorType, uint32_t> sizes,
+									 uint32_t sets) {
+	std::vector<VkDescriptorPoolSize> vkSizes;
+	for(const auto &size : sizes) {
+		if(size.second > 0) {
+			vkSizes.push_back({size.first, size.second});
+		}
+	}
+	if(vkSizes.empty()) {
+		vkSizes.push_back({VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sets});
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(vkSizes.size());
+	poolInfo.pPoolSizes = vkSizes.data();
+	poolInfo.maxSets = sets;
+
+	VkDescriptorPool pool;
+	VkResult result = vkCreateDescriptorPool(BP->device, &poolInfo, nullptr,
+											 &pool);
+	if (result != VK_SUCCESS) {
+		PrintVkError(result);
+		throw std::runtime_error("failed to create descriptor pool!");
+	}
+	pools.push_back(pool);
+
+	poolSizes = sizes;
+	poolSets = sets;
+	freeDescriptors = sizes;
+	freeSets = sets;
+}
+
+void DescriptorAllocator::grow(DescriptorSetLayout *L, uint32_t count) {
+	// At least double the previous pool, keeping the proportions between
+	// descriptor types seen so far
+	uint32_t sets = std::max({minSetsInPool, 2 * poolSets, count});
+	std::map<VkDescriptorType, uint32_t> sizes;
+	for(const auto &req : required) {
+		uint32_t perSet = (req.second + requiredSets - 1) / requiredSets;
+		sizes[req.first] = perSet * sets;
+	}
+	std::map<VkDescriptorType, uint32_t> perSet;
+	for(const auto &binding : L->bindings) {
+		perSet[binding.type]++;
+	}
+	for(const auto &type : perSet) {
+		sizes[type.first] = std::max(sizes[type.first], type.second * sets);
+	}
+
+	std::cout << "Descriptor pool full, chaining pool #" << pools.size() + 1
+			  << " with " << sets << " sets\n";
+	createPool(sizes, sets);
+}
+
+void DescriptorAllocator::allocate(DescriptorSetLayout *L, uint32_t count,
+								   VkDescriptorSet *out) {
+	std::map<VkDescriptorType, uint32_t> needed;
+	for(const auto &binding : L->bindings) {
+		needed[binding.type] += count;
+	}
+
+	bool fits = !pools.empty() && freeSets >= count;
+	for(const auto &need : needed) {
+		fits = fits && freeDescriptors[need.first] >= need.second;
+	}
+	if(!fits) {
+		grow(L, count);
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(count, L->descriptorSetLayout);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = pools.back();
+	allocInfo.descriptorSetCount = count;
+	allocInfo.pSetLayouts = layouts.data();
+
+	VkResult result = vkAllocateDescriptorSets(BP->device, &allocInfo, out);
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY_KHR ||
+		result == VK_ERROR_FRAGMENTED_POOL) {
+		// The driver ran out of space before our accounting did, chain anyway
+		grow(L, count);
+		allocInfo.descriptorPool = pools.back();
+		result = vkAllocateDescriptorSets(BP->device, &allocInfo, out);
+	}
+	if (result != VK_SUCCESS) {
+		PrintVkError(result);
+		throw std::runtime_error("failed to allocate descriptor sets!");
+	}
+
+	freeSets -= count;
+	requiredSets += count;
+	for(const auto &need : needed) {
+		freeDescriptors[need.first] -= need.second;
+		required[need.first] += need.second;
+	}
+}
+
+void DescriptorAllocator::reset() {
+	if(pools.size() > 1) {
+		// Merge the chain in a single pool fitting what has been used
+		std::map<VkDescriptorType, uint32_t> sizes = required;
+		uint32_t sets = requiredSets;
+		cleanup();
+		createPool(sizes, sets);
+	} else if(!pools.empty()) {
+		vkResetDescriptorPool(BP->device, pools[0], 0);
+		freeDescriptors = poolSizes;
+		freeSets = poolSets;
+	}
+	required.clear();
+	requiredSets = 0;
+}
+
+void DescriptorAllocator::cleanup() {
+	for(auto pool : pools) {
+		vkDestroyDescriptorPool(BP->device, pool, nullptr);
+	}
+	pools.clear();
+	poolSizes.clear();
+	poolSets = 0;
+	freeDescriptors.clear();
+	freeSets = 0;
+}
+
+void RenderGraph::init(BaseProject *bp, VkExtent2D extent, uint32_t images) {
+	BP = bp;
+	this->extent = extent;
+	this->images = images;
+	resources.clear();
+	passes.clear();
+	memory.clear();
+	allocatedBytes = 0;
+	requestedBytes = 0;
+	lazyBytes = 0;
+}
+
+RenderGraph::Resource RenderGraph::transient(const std::string &name, VkFormat format,
+		VkSampleCountFlagBits samples, VkImageAspectFlags aspect) {
+	ResourceInfo info{};
+	info.name = name;
+	info.format = format;
+	info.samples = samples;
+	info.aspect = aspect;
+	info.isTransient = true;
+	info.finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	resources.push_back(info);
+	return static_cast<Resource>(resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::imported(const std::string &name, VkFormat format,
+		const std::vector<VkImage> &images, const std::vector<VkImageView> &views,
+		VkImageLayout finalLayout) {
+	ResourceInfo info{};
+	info.name = name;
+	info.format = format;
+	info.samples = VK_SAMPLE_COUNT_1_BIT;
+	info.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	info.isTransient = false;
+	info.finalLayout = finalLayout;
+	info.images = images;
+	info.views = views;
+	resources.push_back(info);
+	return static_cast<Resource>(resources.size() - 1);
+}
+
+RenderGraph::Pass RenderGraph::addPass(const std::string &name, PassType type, Record record) {
+	PassInfo info{};
+	info.name = name;
+	info.type = type;
+	info.record = record;
+	info.renderPass = VK_NULL_HANDLE;
+	passes.push_back(info);
+	return static_cast<Pass>(passes.size() - 1);
+}
+
+void RenderGraph::use(Pass pass, Resource resource, Usage usage) {
+	PassInfo &P = passes[pass];
+	if(std::find(P.resources.begin(), P.resources.end(), resource) != P.resources.end()) {
+		throw std::runtime_error("failed to use " + resources[resource].name +
+								 " twice in pass " + P.name + "!");
+	}
+	P.uses.push_back({pass, usage});
+	P.resources.push_back(resource);
+
+	std::vector<Use> &uses = resources[resource].uses;
+	auto it = uses.begin();
+	while(it != uses.end() && it->pass < pass) {
+		it++;
+	}
+	uses.insert(it, {pass, usage});
+}
+
+void RenderGraph::clear(Pass pass, Resource resource, VkClearValue value) {
+	passes[pass].clears[resource] = value;
+}
+
+bool RenderGraph::isAttachment(Usage usage) {
+	return usage == COLOR_ATTACHMENT || usage == DEPTH_ATTACHMENT ||
+		   usage == RESOLVE_ATTACHMENT;
+}
+
+VkImageLayout RenderGraph::layoutOf(Usage usage) {
+	switch(usage) {
+		case COLOR_ATTACHMENT:
+		case RESOLVE_ATTACHMENT:
+			return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		case DEPTH_ATTACHMENT:
+			return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		case SHADER_READ:
+			return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		case TRANSFER_SRC:
+			return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		case TRANSFER_DST:
+			return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	}
+	return VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+VkPipelineStageFlags RenderGraph::stagesOf(Usage usage) {
+	switch(usage) {
+		case COLOR_ATTACHMENT:
+		case RESOLVE_ATTACHMENT:
+			return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		case DEPTH_ATTACHMENT:
+			return VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+				   VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		case SHADER_READ:
+			return VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		case TRANSFER_SRC:
+		case TRANSFER_DST:
+			return VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+	return VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+}
+
+VkAccessFlags RenderGraph::accessOf(Usage usage) {
+	switch(usage) {
+		case COLOR_ATTACHMENT:
+			return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+				   VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		case RESOLVE_ATTACHMENT:
+			return VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		case DEPTH_ATTACHMENT:
+			return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+				   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		case SHADER_READ:
+			return VK_ACCESS_SHADER_READ_BIT;
+		case TRANSFER_SRC:
+			return VK_ACCESS_TRANSFER_READ_BIT;
+		case TRANSFER_DST:
+			return VK_ACCESS_TRANSFER_WRITE_BIT;
+	}
+	return 0;
+}
+
+VkAccessFlags RenderGraph::writeAccessOf(Usage usage) {
+	// reads need no availability, only the execution dependency
+	return accessOf(usage) & (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+							  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+							  VK_ACCESS_TRANSFER_WRITE_BIT);
+}
+
+const RenderGraph::Use *RenderGraph::previousUse(Resource resource, Pass pass) const {
+	const Use *previous = nullptr;
+	for(const Use &u : resources[resource].uses) {
+		if(u.pass < pass) {
+			previous = &u;
+		}
+	}
+	return previous;
+}
+
+const RenderGraph::Use *RenderGraph::nextUse(Resource resource, Pass pass) const {
+	for(const Use &u : resources[resource].uses) {
+		if(u.pass > pass) {
+			return &u;
+		}
+	}
+	return nullptr;
+}
+
+void RenderGraph::firstUseSource(Resource resource, const Use &use,
+		VkPipelineStageFlags &stages, VkAccessFlags &access) const {
+	const ResourceInfo &R = resources[resource];
+	if(!R.isTransient) {
+		// a swap chain image: the submission waits for its acquisition
+		// before the stage of its first use
+		stages |= stagesOf(use.usage);
+		return;
+	}
+	// the last uses of the memory in the previous frame, of the image itself
+	// and of the ones sharing it
+	std::vector<Resource> sharing = R.aliases;
+	sharing.push_back(resource);
+	for(Resource r : sharing) {
+		if(resources[r].uses.empty()) {
+			continue;
+		}
+		const Use &last = resources[r].uses.back();
+		stages |= stagesOf(last.usage);
+		access |= writeAccessOf(last.usage);
+	}
+}
+
+void RenderGraph::allocateTransients() {
+	struct Placement {
+		Resource resource;
+		VkMemoryRequirements requirements;
+		VkDeviceSize offset;
+	};
+	// by memory type
+	std::map<uint32_t, std::vector<Placement>> heaps;
+	VkPhysicalDeviceMemoryProperties memProperties;
+	vkGetPhysicalDeviceMemoryProperties(BP->physicalDevice, &memProperties);
+
+	for(Resource r = 0; r < resources.size(); r++) {
+		ResourceInfo &R = resources[r];
+		if(!R.isTransient || R.uses.empty()) {
+			continue;
+		}
+		VkImageUsageFlags usage = 0;
+		bool onlyAttachment = true;
+		for(const Use &u : R.uses) {
+			switch(u.usage) {
+				case COLOR_ATTACHMENT:
+				case RESOLVE_ATTACHMENT:
+					usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; break;
+				case DEPTH_ATTACHMENT:
+					usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; break;
+				case SHADER_READ:
+					usage |= VK_IMAGE_USAGE_SAMPLED_BIT; break;
+				case TRANSFER_SRC:
+					usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT; break;
+				case TRANSFER_DST:
+					usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT; break;
+			}
+			onlyAttachment = onlyAttachment && isAttachment(u.usage);
+		}
+		if(onlyAttachment && R.uses.size() == 1) {
+			// never loaded nor stored
+			usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = extent.width;
+		imageInfo.extent.height = extent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = R.format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.samples = R.samples;
+
+		VkImage image;
+		VkResult result = vkCreateImage(BP->device, &imageInfo, nullptr, &image);
+		if(result != VK_SUCCESS) {
+			PrintVkError(result);
+			throw std::runtime_error("failed to create image " + R.name + "!");
+		}
+		R.images.push_back(image);
+
+		Placement P{};
+		P.resource = r;
+		vkGetImageMemoryRequirements(BP->device, image, &P.requirements);
+		// the attachments which are never loaded nor stored may only live in
+		// the tile memory, otherwise they are in the device memory
+		uint32_t type = memProperties.memoryTypeCount;
+		if(usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) {
+			for(uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+				if((P.requirements.memoryTypeBits & (1 << i)) &&
+				   (memProperties.memoryTypes[i].propertyFlags &
+				    VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+					type = i;
+					break;
+				}
+			}
+		}
+		if(type == memProperties.memoryTypeCount) {
+			type = BP->findMemoryType(P.requirements.memoryTypeBits,
+									  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		}
+		heaps[type].push_back(P);
+		requestedBytes += P.requirements.size;
+	}
+
+	for(auto &heap : heaps) {
+		std::vector<Placement> &placements = heap.second;
+		std::sort(placements.begin(), placements.end(),
+				  [](const Placement &a, const Placement &b) {
+			return a.requirements.size > b.requirements.size;
+		});
+
+		// Each image at the lowest offset not used by the images alive in
+		// the same passes, the largest first
+		VkDeviceSize heapSize = 0;
+		for(size_t i = 0; i < placements.size(); i++) {
+			Placement &P = placements[i];
+			const ResourceInfo &R = resources[P.resource];
+			std::vector<const Placement *> alive;
+			for(size_t j = 0; j < i; j++) {
+				const ResourceInfo &O = resources[placements[j].resource];
+				if(O.uses.front().pass <= R.uses.back().pass &&
+				   R.uses.front().pass <= O.uses.back().pass) {
+					alive.push_back(&placements[j]);
+				}
+			}
+			std::sort(alive.begin(), alive.end(),
+					  [](const Placement *a, const Placement *b) {
+				return a->offset < b->offset;
+			});
+			const VkDeviceSize alignment = P.requirements.alignment;
+			P.offset = 0;
+			for(const Placement *O : alive) {
+				VkDeviceSize end = O->offset + O->requirements.size;
+				if(O->offset < P.offset + P.requirements.size && P.offset < end) {
+					P.offset = std::max(P.offset, (end + alignment - 1) / alignment * alignment);
+				}
+			}
+			heapSize = std::max(heapSize, P.offset + P.requirements.size);
+		}
+
+		for(size_t i = 0; i < placements.size(); i++) {
+			for(size_t j = 0; j < i; j++) {
+				const Placement &A = placements[i];
+				const Placement &B = placements[j];
+				if(A.offset < B.offset + B.requirements.size &&
+				   B.offset < A.offset + A.requirements.size) {
+					resources[A.resource].aliases.push_back(B.resource);
+					resources[B.resource].aliases.push_back(A.resource);
+				}
+			}
+		}
+
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = heapSize;
+		allocInfo.memoryTypeIndex = heap.first;
+		VkDeviceMemory heapMemory;
+		VkResult result = vkAllocateMemory(BP->device, &allocInfo, nullptr, &heapMemory);
+		if(result != VK_SUCCESS) {
+			PrintVkError(result);
+			throw std::runtime_error("failed to allocate transient image memory!");
+		}
+		memory.push_back(heapMemory);
+		allocatedBytes += heapSize;
+		if(memProperties.memoryTypes[heap.first].propertyFlags &
+		   VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+			lazyBytes += heapSize;
+		}
+
+		for(const Placement &P : placements) {
+			ResourceInfo &R = resources[P.resource];
+			result = vkBindImageMemory(BP->device, R.images[0], heapMemory, P.offset);
+			if(result != VK_SUCCESS) {
+				PrintVkError(result);
+				throw std::runtime_error("failed to bind transient image memory!");
+			}
+			R.views.push_back(BP->createImageView(R.images[0], R.format, R.aspect,
+												  1, VK_IMAGE_VIEW_TYPE_2D, 1));
+		}
+	}
+}
+
+void RenderGraph::createBarriers(Pass pass) {
+	PassInfo &P = passes[pass];
+	P.barriers.clear();
+	P.finalBarriers.clear();
+	P.srcStages = 0;
+	P.dstStages = 0;
+	P.finalSrcStages = 0;
+	for(size_t i = 0; i < P.uses.size(); i++) {
+		const Use &use = P.uses[i];
+		const Resource r = P.resources[i];
+		if(isAttachment(use.usage)) {
+			// the render pass changes the layout
+			continue;
+		}
+		const Use *previous = previousUse(r, pass);
+		if(previous == nullptr || !isAttachment(previous->usage)) {
+			Barrier B{};
+			B.resource = r;
+			B.newLayout = layoutOf(use.usage);
+			B.dstAccess = accessOf(use.usage);
+			if(previous != nullptr) {
+				B.oldLayout = layoutOf(previous->usage);
+				B.srcAccess = writeAccessOf(previous->usage);
+				P.srcStages |= stagesOf(previous->usage);
+			} else {
+				B.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				firstUseSource(r, use, P.srcStages, B.srcAccess);
+			}
+			P.dstStages |= stagesOf(use.usage);
+			P.barriers.push_back(B);
+		}
+		// otherwise the dependency at the end of the previous render pass
+		// already made it ready
+
+		const ResourceInfo &R = resources[r];
+		if(nextUse(r, pass) == nullptr && !R.isTransient &&
+		   R.finalLayout != layoutOf(use.usage)) {
+			Barrier B{};
+			B.resource = r;
+			B.oldLayout = layoutOf(use.usage);
+			B.newLayout = R.finalLayout;
+			B.srcAccess = writeAccessOf(use.usage);
+			B.dstAccess = 0;
+			P.finalSrcStages |= stagesOf(use.usage);
+			P.finalBarriers.push_back(B);
+		}
+	}
+}
+
+void RenderGraph::createRenderPass(Pass pass) {
+	PassInfo &P = passes[pass];
+	std::vector<VkAttachmentDescription> attachments;
+	std::vector<VkAttachmentReference> colorRefs, resolveRefs;
+	VkAttachmentReference depthRef{};
+	bool hasDepth = false;
+	std::vector<Resource> attached;
+
+	VkSubpassDependency in{};
+	in.srcSubpass = VK_SUBPASS_EXTERNAL;
+	in.dstSubpass = 0;
+	VkSubpassDependency out{};
+	out.srcSubpass = 0;
+	out.dstSubpass = VK_SUBPASS_EXTERNAL;
+
+	for(size_t i = 0; i < P.uses.size(); i++) {
+		const Use &use = P.uses[i];
+		const Resource r = P.resources[i];
+		if(!isAttachment(use.usage)) {
+			continue;
+		}
+		const ResourceInfo &R = resources[r];
+		const Use *previous = previousUse(r, pass);
+		const Use *next = nextUse(r, pass);
+
+		VkAttachmentDescription attachment{};
+		attachment.format = R.format;
+		attachment.samples = R.samples;
+		if(P.clears.count(r) > 0) {
+			attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		} else if(previous != nullptr && use.usage != RESOLVE_ATTACHMENT) {
+			attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		} else {
+			attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		}
+		// only kept if read later
+		attachment.storeOp = (next != nullptr || !R.isTransient) ?
+				VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachment.initialLayout = previous != nullptr ?
+				layoutOf(previous->usage) : VK_IMAGE_LAYOUT_UNDEFINED;
+		if(next != nullptr) {
+			attachment.finalLayout = layoutOf(next->usage);
+		} else if(!R.isTransient) {
+			attachment.finalLayout = R.finalLayout;
+		} else {
+			attachment.finalLayout = layoutOf(use.usage);
+		}
+
+		VkAttachmentReference ref{};
+		ref.attachment = static_cast<uint32_t>(attachments.size());
+		ref.layout = layoutOf(use.usage);
+		if(use.usage == COLOR_ATTACHMENT) {
+			colorRefs.push_back(ref);
+		} else if(use.usage == RESOLVE_ATTACHMENT) {
+			resolveRefs.push_back(ref);
+		} else {
+			depthRef = ref;
+			hasDepth = true;
+		}
+
+		if(previous != nullptr) {
+			in.srcStageMask |= stagesOf(previous->usage);
+			in.srcAccessMask |= writeAccessOf(previous->usage);
+		} else {
+			VkPipelineStageFlags stages = 0;
+			VkAccessFlags access = 0;
+			firstUseSource(r, use, stages, access);
+			in.srcStageMask |= stages;
+			in.srcAccessMask |= access;
+		}
+		in.dstStageMask |= stagesOf(use.usage);
+		in.dstAccessMask |= accessOf(use.usage);
+
+		if(next != nullptr) {
+			out.srcStageMask |= stagesOf(use.usage);
+			out.srcAccessMask |= writeAccessOf(use.usage);
+			out.dstStageMask |= stagesOf(next->usage);
+			out.dstAccessMask |= accessOf(next->usage);
+		}
+
+		VkClearValue clearValue{};
+		if(P.clears.count(r) > 0) {
+			clearValue = P.clears[r];
+		}
+		P.clearValues.push_back(clearValue);
+		attachments.push_back(attachment);
+		attached.push_back(r);
+	}
+	if(!resolveRefs.empty() && resolveRefs.size() != colorRefs.size()) {
+		throw std::runtime_error("failed to match the resolve attachments of pass " +
+								 P.name + "!");
+	}
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+	subpass.pColorAttachments = colorRefs.data();
+	subpass.pResolveAttachments = resolveRefs.empty() ? nullptr : resolveRefs.data();
+	subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+	std::vector<VkSubpassDependency> dependencies = {in};
+	if(out.dstStageMask != 0) {
+		dependencies.push_back(out);
+	}
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	renderPassInfo.pAttachments = attachments.data();
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	renderPassInfo.pDependencies = dependencies.data();
+
+	VkResult result = vkCreateRenderPass(BP->device, &renderPassInfo, nullptr,
+				&P.renderPass);
+	if(result != VK_SUCCESS) {
+		PrintVkError(result);
+		throw std::runtime_error("failed to create render pass " + P.name + "!");
+	}
+
+	P.framebuffers.resize(images);
+	for(uint32_t i = 0; i < images; i++) {
+		std::vector<VkImageView> views;
+		for(Resource r : attached) {
+			views.push_back(resources[r].views[resources[r].isTransient ? 0 : i]);
+		}
+
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = P.renderPass;
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+		framebufferInfo.pAttachments = views.data();
+		framebufferInfo.width = extent.width;
+		framebufferInfo.height = extent.height;
+		framebufferInfo.layers = 1;
+
+		result = vkCreateFramebuffer(BP->device, &framebufferInfo, nullptr,
+					&P.framebuffers[i]);
+		if(result != VK_SUCCESS) {
+			PrintVkError(result);
+			throw std::runtime_error("failed to create framebuffer!");
+		}
+	}
+}
+
+void RenderGraph::compile() {
+	allocateTransients();
+	for(Pass p = 0; p < passes.size(); p++) {
+		createBarriers(p);
+		if(passes[p].type == RASTER) {
+			createRenderPass(p);
+		}
+	}
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, uint32_t image,
+		const std::vector<Barrier> &barriers,
+		VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages) {
+	std::vector<VkImageMemoryBarrier> imageBarriers(barriers.size());
+	for(size_t i = 0; i < barriers.size(); i++) {
+		VkImageMemoryBarrier &barrier = imageBarriers[i];
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = barriers[i].oldLayout;
+		barrier.newLayout = barriers[i].newLayout;
+		barrier.srcAccessMask = barriers[i].srcAccess;
+		barrier.dstAccessMask = barriers[i].dstAccess;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = this->image(barriers[i].resource, image);
+		barrier.subresourceRange.aspectMask = resources[barriers[i].resource].aspect;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.layerCount = 1;
+	}
+	vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0,
+			0, nullptr,
+			0, nullptr,
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer, uint32_t image) {
+	for(PassInfo &P : passes) {
+		if(!P.barriers.empty()) {
+			recordBarriers(commandBuffer, image, P.barriers, P.srcStages, P.dstStages);
+		}
+		if(P.record) {
+			P.record(commandBuffer, image);
+		}
+		if(!P.finalBarriers.empty()) {
+			recordBarriers(commandBuffer, image, P.finalBarriers, P.finalSrcStages,
+						   VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+		}
+	}
+}
+
+void RenderGraph::begin(VkCommandBuffer commandBuffer, Pass pass, uint32_t image,
+		VkExtent2D area, VkSubpassContents contents) {
+	const PassInfo &P = passes[pass];
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = P.renderPass;
+	renderPassInfo.framebuffer = P.framebuffers[image];
+	renderPassInfo.renderArea.offset = {0, 0};
+	renderPassInfo.renderArea.extent = area;
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(P.clearValues.size());
+	renderPassInfo.pClearValues = P.clearValues.data();
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+}
+
+VkRenderPass RenderGraph::renderPass(Pass pass) const {
+	return passes[pass].renderPass;
+}
+
+VkFramebuffer RenderGraph::framebuffer(Pass pass, uint32_t image) const {
+	return passes[pass].framebuffers[image];
+}
+
+VkImage RenderGraph::image(Resource resource, uint32_t image) const {
+	const ResourceInfo &R = resources[resource];
+	return R.images[R.isTransient ? 0 : image];
+}
+
+void RenderGraph::cleanup() {
+	for(PassInfo &P : passes) {
+		for(auto framebuffer : P.framebuffers) {
+			vkDestroyFramebuffer(BP->device, framebuffer, nullptr);
+		}
+		if(P.renderPass != VK_NULL_HANDLE) {
+			vkDestroyRenderPass(BP->device, P.renderPass, nullptr);
+		}
+	}
+	// the imported images belong to the swap chain
+	for(ResourceInfo &R : resources) {
+		if(!R.isTransient) {
+			continue;
+		}
+		for(auto view : R.views) {
+			vkDestroyImageView(BP->device, view, nullptr);
+		}
+		for(auto image : R.images) {
+			vkDestroyImage(BP->device, image, nullptr);
+		}
+	}
+	for(auto heap : memory) {
+		vkFreeMemory(BP->device, heap, nullptr);
+	}
+	passes.clear();
+	resources.clear();
+	memory.clear();
+}
\ No newline at end of file
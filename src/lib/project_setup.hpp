@@ -16,6 +16,9 @@
 #include <algorithm>
 #include <fstream>
 #include <array>
+#include <map>
+#include <tuple>
+#include <functional>
 #include <vulkan/vulkan.h>
 
 #define GLM_FORCE_RADIANS
@@ -27,6 +30,11 @@
 
 #include <chrono>
 
+#include <work_stealing_pool.hpp>
+#include <input_log.hpp>
+#include <resolution_controller.hpp>
+#include <frame_stats.hpp>
+
 #include <tiny_obj_loader.h>
 
 #include <stb_image.h>
@@ -149,6 +157,46 @@ class Model {
   	void bind(VkCommandBuffer commandBuffer);
 };
 
+// Sampler parameters used to share VkSampler objects among textures
+struct SamplerKey {
+	VkSamplerCreateFlags flags;
+	VkFilter magFilter;
+	VkFilter minFilter;
+	VkSamplerMipmapMode mipmapMode;
+	VkSamplerAddressMode addressModeU;
+	VkSamplerAddressMode addressModeV;
+	VkSamplerAddressMode addressModeW;
+	float mipLodBias;
+	VkBool32 anisotropyEnable;
+	float maxAnisotropy;
+	VkBool32 compareEnable;
+	VkCompareOp compareOp;
+	float minLod;
+	float maxLod;
+	VkBorderColor borderColor;
+	VkBool32 unnormalizedCoordinates;
+
+	SamplerKey(const VkSamplerCreateInfo &info);
+	bool operator<(const SamplerKey &other) const;
+};
+
+// Reference counted samplers, textures with identical sampling parameters
+// get the same VkSampler handle
+struct SamplerCache {
+	BaseProject *BP;
+
+	struct Entry {
+		VkSampler sampler;
+		uint32_t refs;
+	};
+	std::map<SamplerKey, Entry> samplers;
+
+	VkSampler acquire(BaseProject *bp, const VkSamplerCreateInfo &info);
+	void release(VkSampler sampler);
+	inline size_t liveSamplers() const { return samplers.size(); }
+	void cleanup();
+};
+
 struct Texture {
 	BaseProject *BP;
 	uint32_t mipLevels;
@@ -160,6 +208,8 @@ struct Texture {
 	static const int maxImgs = 6;
 	
 	void createTextureImage(const char *const files[], VkFormat Fmt);
+	// imgs layers of texWidth x texHeight RGBA texels
+	void uploadTextureImage(stbi_uc *const pixels[], int texWidth, int texHeight, VkFormat Fmt);
 	void createTextureImageView(VkFormat Fmt);
 	void createTextureSampler(VkFilter magFilter,
 							 VkFilter minFilter,
@@ -173,6 +223,10 @@ struct Texture {
 
 	void init(BaseProject *bp, const char * file, VkFormat Fmt = VK_FORMAT_R8G8B8A8_SRGB, bool initSampler = true);
 	void initCubic(BaseProject *bp, const char * files[6]);
+	// Cube map from an equirectangular image, converted when loaded. A
+	// faceSize of 0 keeps the horizontal resolution of the image
+	void initEquirect(BaseProject *bp, const char * file, int faceSize = 0,
+					  VkFormat Fmt = VK_FORMAT_R8G8B8A8_SRGB);
 	void cleanup();
 };
 
@@ -186,11 +240,177 @@ struct DescriptorSetLayoutBinding {
 struct DescriptorSetLayout {
 	BaseProject *BP;
  	VkDescriptorSetLayout descriptorSetLayout;
+	// Kept to compute the pool requirements of the sets using this layout
+	std::vector<DescriptorSetLayoutBinding> bindings;
  	
  	void init(BaseProject *bp, std::vector<DescriptorSetLayoutBinding> B);
 	void cleanup();
 };
 
+// Chain of descriptor pools: when the last pool runs out of space a new one
+// is created instead of failing the allocation. The descriptors requested
+// through it are accounted, so that the next init (e.g. after a swap chain
+// recreation) can size a single pool matching the actual requirements
+struct DescriptorAllocator {
+	BaseProject *BP;
+	std::vector<VkDescriptorPool> pools;
+
+	// Size of pools.back() and space left in it
+	std::map<VkDescriptorType, uint32_t> poolSizes;
+	uint32_t poolSets = 0;
+	std::map<VkDescriptorType, uint32_t> freeDescriptors;
+	uint32_t freeSets = 0;
+
+	// Descriptors and sets allocated since the last init
+	std::map<VkDescriptorType, uint32_t> required;
+	uint32_t requiredSets = 0;
+
+	static const uint32_t minSetsInPool = 16;
+
+	void init(BaseProject *bp, std::map<VkDescriptorType, uint32_t> sizes,
+			  uint32_t sets);
+	void allocate(DescriptorSetLayout *L, uint32_t count, VkDescriptorSet *out);
+	void reset();
+	void cleanup();
+
+	private:
+	void createPool(std::map<VkDescriptorType, uint32_t> sizes, uint32_t sets);
+	void grow(DescriptorSetLayout *L, uint32_t count);
+};
+
+// Passes of a frame and the images they use: each pass declares its uses of
+// the images, in the order the passes run, and the graph derives the layouts
+// and the load and store operations of the attachments, the subpass
+// dependencies of the render passes and the barriers before the other
+// passes. The transient images are created by the graph as large as the
+// frame, the ones which are never alive at the same time share their memory
+struct RenderGraph {
+	typedef uint32_t Resource;
+	typedef uint32_t Pass;
+
+	enum PassType {
+		RASTER,		// a render pass with a subpass, begun by its callback
+		TRANSFER	// outside of render passes, e.g. blits
+	};
+	enum Usage {
+		COLOR_ATTACHMENT,
+		DEPTH_ATTACHMENT,
+		RESOLVE_ATTACHMENT,	// of the color attachments, in the same order
+		SHADER_READ,		// sampled by the fragment shaders
+		TRANSFER_SRC,
+		TRANSFER_DST
+	};
+	// Records a pass for a swap chain image
+	typedef std::function<void(VkCommandBuffer, uint32_t)> Record;
+
+	BaseProject *BP;
+
+	// Memory of the transient images, and what it would be without aliasing
+	VkDeviceSize allocatedBytes = 0;
+	VkDeviceSize requestedBytes = 0;
+	// Part of allocatedBytes which is lazily allocated, and may never be
+	// committed on tile based GPUs
+	VkDeviceSize lazyBytes = 0;
+
+	void init(BaseProject *bp, VkExtent2D extent, uint32_t images);
+	// Image created by compile. The ones only used as attachments by a single
+	// pass are neither loaded nor stored, and get lazily allocated memory
+	// where the device has it
+	Resource transient(const std::string &name, VkFormat format,
+					   VkSampleCountFlagBits samples, VkImageAspectFlags aspect);
+	// One image for each swap chain image, left in finalLayout at the end of
+	// the frame (the content of the previous frame is not kept)
+	Resource imported(const std::string &name, VkFormat format,
+					  const std::vector<VkImage> &images,
+					  const std::vector<VkImageView> &views,
+					  VkImageLayout finalLayout);
+	// Passes run in the order they are added
+	Pass addPass(const std::string &name, PassType type, Record record);
+	void use(Pass pass, Resource resource, Usage usage);
+	// The attachment is cleared when the pass begins
+	void clear(Pass pass, Resource resource, VkClearValue value);
+	// Creates the transient images, the render passes and the framebuffers
+	void compile();
+
+	// Records the passes, each after its barriers
+	void execute(VkCommandBuffer commandBuffer, uint32_t image);
+	// For the callback of a RASTER pass, ended by vkCmdEndRenderPass
+	void begin(VkCommandBuffer commandBuffer, Pass pass, uint32_t image,
+			   VkExtent2D area, VkSubpassContents contents);
+
+	VkRenderPass renderPass(Pass pass) const;
+	VkFramebuffer framebuffer(Pass pass, uint32_t image) const;
+	VkImage image(Resource resource, uint32_t image) const;
+
+	void cleanup();
+
+	private:
+	struct Use {
+		Pass pass;
+		Usage usage;
+	};
+	struct ResourceInfo {
+		std::string name;
+		VkFormat format;
+		VkSampleCountFlagBits samples;
+		VkImageAspectFlags aspect;
+		bool isTransient;
+		VkImageLayout finalLayout;
+		// one for each swap chain image if imported, otherwise a single one
+		std::vector<VkImage> images;
+		std::vector<VkImageView> views;
+		// sorted by pass
+		std::vector<Use> uses;
+		// transient images bound to the same memory
+		std::vector<Resource> aliases;
+	};
+	struct Barrier {
+		Resource resource;
+		VkImageLayout oldLayout, newLayout;
+		VkAccessFlags srcAccess, dstAccess;
+	};
+	struct PassInfo {
+		std::string name;
+		PassType type;
+		Record record;
+		// in the order of the attachments
+		std::vector<Use> uses;
+		std::vector<Resource> resources;
+		std::map<Resource, VkClearValue> clears;
+		VkRenderPass renderPass;
+		std::vector<VkFramebuffer> framebuffers;
+		std::vector<VkClearValue> clearValues;
+		// of the uses which are not attachments, before and after the callback
+		std::vector<Barrier> barriers, finalBarriers;
+		VkPipelineStageFlags srcStages, dstStages, finalSrcStages;
+	};
+
+	VkExtent2D extent;
+	uint32_t images;
+	std::vector<ResourceInfo> resources;
+	std::vector<PassInfo> passes;
+	std::vector<VkDeviceMemory> memory;
+
+	static bool isAttachment(Usage usage);
+	static VkImageLayout layoutOf(Usage usage);
+	static VkPipelineStageFlags stagesOf(Usage usage);
+	static VkAccessFlags accessOf(Usage usage);
+	static VkAccessFlags writeAccessOf(Usage usage);
+	// Uses of the resource around the pass in the same frame, nullptr if none
+	const Use *previousUse(Resource resource, Pass pass) const;
+	const Use *nextUse(Resource resource, Pass pass) const;
+	// What the first use of the resource in the frame waits for
+	void firstUseSource(Resource resource, const Use &use,
+						VkPipelineStageFlags &stages, VkAccessFlags &access) const;
+	void allocateTransients();
+	void createBarriers(Pass pass);
+	// With its framebuffers
+	void createRenderPass(Pass pass);
+	void recordBarriers(VkCommandBuffer commandBuffer, uint32_t image,
+						const std::vector<Barrier> &barriers,
+						VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages);
+};
+
 struct Pipeline {
 	BaseProject *BP;
 	VkPipeline graphicsPipeline;
@@ -206,22 +426,83 @@ struct Pipeline {
  	bool transp;
 	
 	VertexDescriptor *VD;
+	// Drawn by populateOverlayCommands, at native resolution when the scene
+	// is not (dynamicResolution)
+	bool overlay;
+	// Specialization constants of both stages, a stage ignores the ids it
+	// does not declare
+	std::vector<VkSpecializationMapEntry> specEntries;
+	std::vector<uint8_t> specData;
   	
   	void init(BaseProject *bp, VertexDescriptor *vd,
 			  const std::string& VertShader, const std::string& FragShader,
   			  std::vector<DescriptorSetLayout *> D);
   	void setAdvancedFeatures(VkCompareOp _compareOp, VkPolygonMode _polyModel,
  						VkCullModeFlagBits _CM, bool _transp);
+	// Value of the constant with layout(constant_id = id), between init and
+	// create: pipelines built from the same shaders with different values
+	// are variants compiled with the constant folded
+	template <class T>
+	void setConstant(uint32_t id, T value);
+	// bool constants are 32 bit
+	inline void setConstant(uint32_t id, bool value) {
+		setConstant<VkBool32>(id, value ? VK_TRUE : VK_FALSE);
+	}
   	void create();
   	void destroy();
   	void bind(VkCommandBuffer commandBuffer);
   	
-  	VkShaderModule createShaderModule(const std::vector<char>& code);
+  	// Module of the SPIR-V file, stage only names it in the log. Also used
+  	// by ComputePipeline
+  	static VkShaderModule loadShaderModule(BaseProject *bp, const std::string& file,
+  										   const char *stage);
   	static std::vector<char> readFile(const std::string& filename);  	
 	void cleanup();
 };
 
-enum DescriptorSetElementType {UNIFORM, TEXTURE};
+template <class T>
+void Pipeline::setConstant(uint32_t id, T value) {
+	static_assert(sizeof(T) == 4 || sizeof(T) == 8, "scalar constants only");
+	for (auto &entry : specEntries) {
+		if (entry.constantID == id) {
+			std::memcpy(specData.data() + entry.offset, &value, sizeof(T));
+			return;
+		}
+	}
+	VkSpecializationMapEntry entry{};
+	entry.constantID = id;
+	entry.offset = static_cast<uint32_t>(specData.size());
+	entry.size = sizeof(T);
+	specEntries.push_back(entry);
+	specData.resize(specData.size() + sizeof(T));
+	std::memcpy(specData.data() + entry.offset, &value, sizeof(T));
+}
+
+// Compute shader with its own pipeline, used outside of the render pass
+// (see BaseProject::populateComputeCommands)
+struct ComputePipeline {
+	BaseProject *BP;
+	VkPipeline computePipeline;
+	VkPipelineLayout pipelineLayout;
+
+	VkShaderModule compShaderModule;
+	std::vector<DescriptorSetLayout *> D;
+	// bytes of push constants, 0 if the shader uses none
+	uint32_t pushConstantSize;
+
+	void init(BaseProject *bp, const std::string& CompShader,
+			  std::vector<DescriptorSetLayout *> D, uint32_t pushConstantSize = 0);
+	void create();
+	void destroy();
+	void bind(VkCommandBuffer commandBuffer);
+	void push(VkCommandBuffer commandBuffer, const void *data);
+	void cleanup();
+};
+
+// STORAGE elements are storage buffers of the given size, written with map
+// as the uniform ones. INDIRECT ones are storage buffers which can also hold
+// the parameters of indirect draws
+enum DescriptorSetElementType {UNIFORM, TEXTURE, STORAGE, INDIRECT};
 
 struct DescriptorSetElement {
 	int binding;
@@ -243,7 +524,11 @@ struct DescriptorSet {
 		std::vector<DescriptorSetElement> E);
 	void cleanup();
   	void bind(VkCommandBuffer commandBuffer, Pipeline &P, int setId, int currentImage);
+  	void bind(VkCommandBuffer commandBuffer, ComputePipeline &P, int setId, int currentImage);
   	void map(int currentImage, void *src, int size, int slot);
+	// Copy back what the GPU wrote in a buffer, once the last frame using
+	// this image is complete
+  	void read(int currentImage, void *dst, int size, int slot);
 };
 
 
@@ -253,21 +538,74 @@ class BaseProject {
 	template <class Vert> friend class Model;
 	friend struct Texture;
 	friend struct Pipeline;
+	friend struct ComputePipeline;
 	friend struct DescriptorSetLayout;
 	friend struct DescriptorSet;
+	friend struct DescriptorAllocator;
+	friend struct SamplerCache;
+	friend struct RenderGraph;
 public:
 	virtual void setWindowParameters() = 0;
     void run();
 
+	// Input log: set recordInputFile to save the input of every frame, or
+	// replayInputFile to read it from a log instead of the controllers (the
+	// window closes at the end of the log). replayDeltaT > 0 replaces the
+	// recorded frame times with a fixed one
+	std::string recordInputFile;
+	std::string replayInputFile;
+	float replayDeltaT = 0.0f;
+
+	// Count the fragment shader invocations of each frame with a pipeline
+	// statistics query, disabled if the device does not support it
+	bool fragmentStatistics = false;
+	// Of the last frame completed with the current image
+	uint64_t fragmentInvocations = 0;
+
+	// Measure the GPU time of each frame with timestamps, disabled if the
+	// graphics queue does not support them
+	bool gpuTiming = false;
+	// Of the last frame completed with the current image, in seconds
+	double gpuFrameTime = 0.0;
+
+	// Dynamic resolution: the scene is rendered offscreen at a fraction of
+	// the swap chain extent chosen by the controller from the GPU time of the
+	// frames (needs gpuTiming, turned on with it), then scaled up to the swap
+	// chain with a filtered blit. The overlay is drawn after the blit, at
+	// native resolution
+	bool dynamicResolution = false;
+	ResolutionController resolution;
+
+	// Headless: no window and no surface, headlessFrames frames are rendered
+	// into offscreen images in place of the swap chain ones, with the same
+	// command buffers. The frames listed in captureFrames are saved to
+	// capturePrefix<frame>.png. The input is zero, or replayed, and every
+	// frame lasts replayDeltaT (1/60 s if not set) so that the images of two
+	// runs are the same
+	bool headless = false;
+	uint64_t headlessFrames = 600;
+	std::set<uint64_t> captureFrames;
+	std::string capturePrefix = "frame";
+	// Frames submitted since the start
+	uint64_t frameNumber = 0;
+
+	// Keep the CPU, fence wait and GPU times of every frame in frameStats
+	// (the GPU ones need gpuTiming)
+	bool recordFrameStats = false;
+	FrameStats frameStats;
+
 protected:
 	uint32_t windowWidth;
 	uint32_t windowHeight;
 	bool windowResizable;
 	std::string windowTitle;
 	VkClearColorValue initialBackgroundColor;
-	int uniformBlocksInPool;
-	int texturesInPool;
-	int setsInPool;
+	// Optional hints for the size of the first descriptor pool, the pool
+	// grows on demand and is resized to the actual needs after a swap chain
+	// recreation, leave them to 0 to let the allocator size it
+	int uniformBlocksInPool = 0;
+	int texturesInPool = 0;
+	int setsInPool = 0;
 
     GLFWwindow* window;
     VkInstance instance;
@@ -279,6 +617,34 @@ protected:
     VkQueue presentQueue;
 	VkCommandPool commandPool;
 	std::vector<VkCommandBuffer> commandBuffers;
+	// One query for each swap chain image, with fragmentStatistics
+	VkQueryPool statisticsQueryPool = VK_NULL_HANDLE;
+	// Two timestamps for each swap chain image, at the beginning and at the
+	// end of its command buffer, with gpuTiming
+	VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+	// Nanoseconds per timestamp tick
+	float timestampPeriod = 1.0f;
+	// The queries of an image hold results only once its command buffer has
+	// been submitted, until then they are not even reset
+	std::vector<bool> imagesSubmitted;
+
+	// Parallel recording: each command group is recorded by a worker thread
+	// in a secondary command buffer, then executed by the primary one
+	bool parallelRecording = false;
+	// Record the command buffer of each image again before submitting it,
+	// instead of only when the swap chain is created
+	bool recordEveryFrame = false;
+	WorkStealingPool *recordingPool = nullptr;
+
+	// Command pool of a worker for a swap chain image, with the secondary
+	// command buffers allocated from it (reused after each reset)
+	struct SecondaryCommandPool {
+		VkCommandPool pool;
+		std::vector<VkCommandBuffer> buffers;
+		size_t used;
+	};
+	// Indexed by [swap chain image][worker]
+	std::vector<std::vector<SecondaryCommandPool>> secondaryCommandPools;
 
     VkSwapchainKHR swapChain;
     std::vector<VkImage> swapChainImages;
@@ -286,24 +652,39 @@ protected:
 	VkExtent2D swapChainExtent;
 	std::vector<VkImageView> swapChainImageViews;
 	
+	// The passes of a frame, with the images they use. renderPass and
+	// overlayRenderPass are owned by it
+	RenderGraph renderGraph;
+	RenderGraph::Pass scenePass, overlayPass;
 	VkRenderPass renderPass;
 	
- 	VkDescriptorPool descriptorPool;
+ 	DescriptorAllocator descriptorAllocator;
+	// One allocator for each swap chain image, reset by drawFrame once the
+	// fence of the image has been waited: use them for sets living a single
+	// frame, bound by command buffers recorded with recordEveryFrame
+	std::vector<DescriptorAllocator> transientDescriptorAllocators;
+
+	SamplerCache samplerCache;
+
+	InputRecorder *inputRecorder = nullptr;
+	InputReplay *inputReplay = nullptr;
 
 	VkDebugUtilsMessengerEXT debugMessenger;
 	
-	VkImage depthImage;
-	VkDeviceMemory depthImageMemory;
-	VkImageView depthImageView;
-
 	VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
-	VkImage colorImage;
-	VkDeviceMemory colorImageMemory;
-	VkImageView colorImageView;
 
-	std::vector<VkFramebuffer> swapChainFramebuffers;
+	// With dynamicResolution the overlay pass draws on the swap chain image
+	// after the scene has been scaled to it
+	VkRenderPass overlayRenderPass;
+	// Area drawn by the frame being recorded
+	VkExtent2D renderExtent;
 	size_t currentFrame = 0;
 	bool framebufferResized = false;
+	// Memory of the offscreen images, with headless
+	std::vector<VkDeviceMemory> offscreenImageMemory;
+	// With headless, the end of a replay stops the loop in place of the
+	// window closing
+	bool closeRequested = false;
 
 	std::vector<VkSemaphore> imageAvailableSemaphores;
 	std::vector<VkSemaphore> renderFinishedSemaphores;
@@ -390,6 +771,8 @@ protected:
 	
 	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
+	void createOffscreenImages();
+
 	void createImageViews();
 	
 	VkImageView createImageView(VkImage image, VkFormat format,
@@ -397,16 +780,15 @@ protected:
 								uint32_t mipLevels, VkImageViewType type, int layerCount
 								);
 	
-	void createRenderPass();
-
-    void createFramebuffers();
+	// The passes of a frame and their attachments: the multisampled color
+	// and depth, resolved to the swap chain image or, with
+	// dynamicResolution, to a transient image as large as the swap chain of
+	// which only renderExtent is drawn, blitted by the upscale pass before
+	// the overlay pass
+	void createRenderGraph();
 
     void createCommandPool();
 
-	void createColorResources();
-
-	void createDepthResources();
-
 	VkFormat findDepthFormat();
 	
 	VkFormat findSupportedFormat(const std::vector<VkFormat> candidates,
@@ -449,10 +831,52 @@ protected:
 							VkMemoryPropertyFlags properties);
     
 	void createDescriptorPool();
+
+	// A set valid until currentImage is acquired again
+	VkDescriptorSet allocateTransientDescriptorSet(DescriptorSetLayout *L,
+												   int currentImage);
 	
 	virtual void populateCommandBuffer(VkCommandBuffer commandBuffer, int i) = 0;
 
+	// Commands recorded before the render pass begins (compute dispatches
+	// and their barriers), in the primary command buffer
+	virtual void populateComputeCommands(VkCommandBuffer commandBuffer, int currentImage) {}
+	// Commands recorded after the last pass (e.g. barriers making buffers
+	// written by the GPU visible to the host), in the primary command buffer
+	virtual void populateFinalCommands(VkCommandBuffer commandBuffer, int currentImage) {}
+
+	// Number of groups the draw calls are split into for parallel recording,
+	// and recording of a single group (each must bind all the state it uses)
+	virtual int commandGroups() { return 0; }
+	virtual void populateCommandGroup(VkCommandBuffer commandBuffer,
+									  int currentImage, int group) {}
+
+	// Draws with the overlay pipelines, at native resolution, after the
+	// scene has been scaled up. Only called with dynamicResolution,
+	// otherwise the overlay is part of the scene
+	virtual void populateOverlayCommands(VkCommandBuffer commandBuffer, int currentImage) {}
+
+	// The pipelines have a dynamic viewport and scissor, set for every
+	// command buffer drawing with them
+	void setViewport(VkCommandBuffer commandBuffer, VkExtent2D extent);
+
     void createCommandBuffers();
+	void createStatisticsQueryPool();
+	void createTimestampQueryPool();
+
+	// Callbacks of the passes of renderGraph
+	void recordScenePass(VkCommandBuffer commandBuffer, int currentImage);
+	// Blit of the renderExtent drawn in scene to the whole target image
+	void upscaleScene(VkCommandBuffer commandBuffer, VkImage scene, VkImage target);
+	void recordOverlayPass(VkCommandBuffer commandBuffer, int currentImage);
+
+	void recordCommandBuffer(int currentImage);
+
+	VkCommandBuffer recordCommandGroup(int currentImage, int group);
+
+	void createSecondaryCommandPools();
+
+	void cleanupSecondaryCommandPools();
     
     void createSyncObjects();
 	
@@ -460,6 +884,9 @@ protected:
     
     void drawFrame();
 
+	// Copies a rendered image to a PNG file, waits for the GPU
+	void saveImage(uint32_t imageIndex, const std::string &file);
+
 	virtual void updateUniformBuffer(uint32_t currentImage) = 0;
 
 	virtual void pipelinesAndDescriptorSetsCleanup() = 0;
@@ -477,6 +904,13 @@ protected:
 	
 	
 	// Control Wrapper
+	// Timer and mouse position of the previous getSixAxis call
+	struct ControlsState {
+		bool started = false;
+		std::chrono::high_resolution_clock::time_point startTime;
+		float lastTime = 0.0f;
+		double old_xpos = 0, old_ypos = 0;
+	} controls;
 	void handleGamePad(int id,  glm::vec3 &m, glm::vec3 &r, bool &fire);
 		
 	void getSixAxis(float &deltaT, glm::vec3 &m, glm::vec3 &r, bool &fire);
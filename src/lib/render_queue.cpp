@@ -0,0 +1,171 @@
+#include <render_queue.hpp>
+#include <algorithm>
+#include <cmath>
+
+// Bits of the fields of the key, from the most significant
+#define PASS_BITS 4
+#define OCTAVE_BITS 4
+#define PIPELINE_BITS 8
+#define MATERIAL_BITS 16
+#define MESH_BITS 8
+#define DEPTH_BITS 24
+
+RenderQueue::Stats &RenderQueue::Stats::operator+=(const Stats &s) {
+    draws += s.draws;
+    pipelines += s.pipelines;
+    descriptorSets += s.descriptorSets;
+    meshes += s.meshes;
+    skipped += s.skipped;
+    return *this;
+}
+
+void RenderQueue::clear() {
+    draws.clear();
+    order.clear();
+}
+
+// Number of the value, the same every frame, the last one for all the
+// values past the bits of the field
+template <class K>
+static uint32_t fieldId(std::map<K, uint32_t> &ids, const K &value, int bits) {
+    auto it = ids.find(value);
+    if(it == ids.end()) {
+        it = ids.emplace(value, std::min<uint32_t>(ids.size(), (1u << bits) - 1)).first;
+    }
+    return it->second;
+}
+
+RenderQueue::Draw &RenderQueue::add(uint32_t pass, Pipeline &pipeline,
+                                    const std::vector<DescriptorSet *> &sets,
+                                    void *mesh, uint32_t count, float depth) {
+    if(sets.size() > MAX_SETS) {
+        throw std::runtime_error("Too many descriptor sets for a draw");
+    }
+    Draw draw{};
+    draw.pipeline = &pipeline;
+    std::copy(sets.begin(), sets.end(), draw.sets.begin());
+    draw.mesh = mesh;
+    draw.count = count;
+    draw.instances = 1;
+
+    depth = std::clamp(depth, 0.0f, 1.0f);
+    uint64_t quantized = static_cast<uint64_t>(depth * ((1u << DEPTH_BITS) - 1));
+    // the last octave ends at 1, the first one holds everything nearer
+    const int octaves = 1 << OCTAVE_BITS;
+    int octave = depth > 0.0f ? octaves - 1 + static_cast<int>(std::floor(std::log2(depth))) : 0;
+    uint64_t key = std::min<uint32_t>(pass, (1u << PASS_BITS) - 1);
+    key = (key << OCTAVE_BITS) | std::clamp(octave, 0, octaves - 1);
+    key = (key << PIPELINE_BITS) | fieldId<const Pipeline *>(pipelineIds, &pipeline, PIPELINE_BITS);
+    key = (key << MATERIAL_BITS) | fieldId(materialIds, draw.sets, MATERIAL_BITS);
+    key = (key << MESH_BITS) | fieldId<const void *>(meshIds, mesh, MESH_BITS);
+    draw.key = (key << DEPTH_BITS) | quantized;
+
+    draws.push_back(draw);
+    return draws.back();
+}
+
+RenderQueue::Draw &RenderQueue::submit(uint32_t pass, Pipeline &pipeline,
+                                       std::vector<DescriptorSet *> sets,
+                                       uint32_t count, float depth) {
+    return add(pass, pipeline, sets, nullptr, count, depth);
+}
+
+void RenderQueue::sort() {
+    const size_t n = draws.size();
+    order.resize(n);
+    scratch.resize(n);
+    for(size_t i = 0; i < n; i++) {
+        order[i] = {draws[i].key, static_cast<uint32_t>(i)};
+    }
+
+    // LSD radix sort, a byte at a time, skipping the bytes equal in all the
+    // keys (most of them: the fields are small numbers)
+    for(int shift = 0; shift < 64 && n > 1; shift += 8) {
+        size_t offsets[256] = {};
+        for(const Entry &e : order) {
+            offsets[(e.key >> shift) & 0xff]++;
+        }
+        if(offsets[(order[0].key >> shift) & 0xff] == n) {
+            continue;
+        }
+        size_t sum = 0;
+        for(size_t &o : offsets) {
+            size_t c = o;
+            o = sum;
+            sum += c;
+        }
+        for(const Entry &e : order) {
+            scratch[offsets[(e.key >> shift) & 0xff]++] = e;
+        }
+        order.swap(scratch);
+    }
+}
+
+size_t RenderQueue::passBegin(uint32_t pass) const {
+    const int shift = 64 - PASS_BITS;
+    return std::partition_point(order.begin(), order.end(),
+        [&](const Entry &e) { return (e.key >> shift) < pass; }) - order.begin();
+}
+
+RenderQueue::Stats RenderQueue::record(VkCommandBuffer commandBuffer, int currentImage,
+                                       size_t first, size_t last) const {
+    Stats stats;
+    const Pipeline *pipeline = nullptr;
+    std::array<DescriptorSet *, MAX_SETS> bound{};
+    const void *mesh = nullptr;
+
+    for(size_t k = first; k < last && k < order.size(); k++) {
+        const Draw &draw = draws[order[k].draw];
+
+        if(draw.pipeline != pipeline) {
+            draw.pipeline->bind(commandBuffer);
+            stats.pipelines++;
+            // the sets stay bound up to the first one with a different
+            // layout (the graphics pipelines have no push constants)
+            for(int s = 0; s < MAX_SETS; s++) {
+                bool compatible = pipeline != nullptr &&
+                    s < (int)pipeline->D.size() && s < (int)draw.pipeline->D.size() &&
+                    pipeline->D[s] == draw.pipeline->D[s];
+                if(!compatible) {
+                    std::fill(bound.begin() + s, bound.end(), nullptr);
+                    break;
+                }
+            }
+            pipeline = draw.pipeline;
+        } else {
+            stats.skipped++;
+        }
+
+        for(int s = 0; s < MAX_SETS; s++) {
+            if(draw.sets[s] == nullptr) {
+                continue;
+            }
+            if(draw.sets[s] == bound[s]) {
+                stats.skipped++;
+                continue;
+            }
+            draw.sets[s]->bind(commandBuffer, *draw.pipeline, s, currentImage);
+            bound[s] = draw.sets[s];
+            stats.descriptorSets++;
+        }
+
+        if(draw.mesh != nullptr && draw.mesh != mesh) {
+            draw.bindMesh(commandBuffer, draw.mesh);
+            mesh = draw.mesh;
+            stats.meshes++;
+        } else if(draw.mesh != nullptr) {
+            stats.skipped++;
+        }
+
+        if(draw.indirect != VK_NULL_HANDLE) {
+            vkCmdDrawIndexedIndirect(commandBuffer, draw.indirect, 0, 1,
+                sizeof(VkDrawIndexedIndirectCommand));
+        } else if(draw.mesh != nullptr) {
+            vkCmdDrawIndexed(commandBuffer, draw.count, draw.instances, 0, 0, draw.firstInstance);
+        } else {
+            vkCmdDraw(commandBuffer, draw.count, draw.instances, 0, draw.firstInstance);
+        }
+        stats.draws++;
+    }
+    return stats;
+}
@@ -0,0 +1,105 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <project_setup.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Draw calls of a frame. Every draw gets a 64-bit key, from the most to the
+// least significant bits: pass (4), depth octave (4), pipeline (8),
+// material (16), mesh (8) and depth (24). The queue is radix sorted by key:
+// within a pass the draws go front to back by octaves of distance (each
+// twice as far as the one before), so the early depth test still rejects
+// what the near objects hide, and within an octave the draws which share a
+// pipeline, descriptor sets and mesh end up next to each other, recorded
+// binding only what differs from the draw before. Pipelines, materials and
+// meshes are numbered in the order they are first submitted, the numbers
+// are kept across frames: the first ones submitted are drawn first within
+// an octave.
+class RenderQueue {
+public:
+    static const int MAX_SETS = 4;
+
+    struct Draw {
+        uint64_t key;
+        Pipeline *pipeline;
+        // bound at their index, the unused ones are nullptr
+        std::array<DescriptorSet *, MAX_SETS> sets;
+        // nullptr without vertex buffer, the vertices come from gl_VertexIndex
+        void *mesh;
+        void (*bindMesh)(VkCommandBuffer commandBuffer, void *mesh);
+        // indices, or vertices without a mesh
+        uint32_t count;
+        uint32_t instances;
+        uint32_t firstInstance;
+        // if not VK_NULL_HANDLE, the indexed draw command is read from it
+        VkBuffer indirect;
+    };
+
+    // Commands recorded, skipped counts the binds left out because the same
+    // state was already bound
+    struct Stats {
+        size_t draws = 0;
+        size_t pipelines = 0;
+        size_t descriptorSets = 0;
+        size_t meshes = 0;
+        size_t skipped = 0;
+
+        Stats &operator+=(const Stats &s);
+    };
+
+    void clear();
+    // Draw of count indices of the model, depth in [0, 1] orders the draws
+    // by octave, then the ones with the same state (0 for all to keep the
+    // order of submission).
+    // Returns the draw to change the instances or make it indirect, valid
+    // until the next submit
+    template <class Vert>
+    Draw &submit(uint32_t pass, Pipeline &pipeline, std::vector<DescriptorSet *> sets,
+                 Model<Vert> &model, float depth = 0.0f);
+    // Without vertex buffer, count vertices
+    Draw &submit(uint32_t pass, Pipeline &pipeline, std::vector<DescriptorSet *> sets,
+                 uint32_t count, float depth = 0.0f);
+    // Sorts the draws submitted since clear by key, stable
+    void sort();
+
+    inline size_t size() const { return order.size(); }
+    // Index in the sorted draws of the first one of the pass or a later one
+    size_t passBegin(uint32_t pass) const;
+    // Records the sorted draws [first, last), the command buffer starts with
+    // nothing bound
+    Stats record(VkCommandBuffer commandBuffer, int currentImage,
+                 size_t first, size_t last) const;
+
+private:
+    struct Entry {
+        uint64_t key;
+        uint32_t draw;
+    };
+    std::vector<Draw> draws;
+    std::vector<Entry> order, scratch;
+    std::map<const Pipeline *, uint32_t> pipelineIds;
+    std::map<std::array<DescriptorSet *, MAX_SETS>, uint32_t> materialIds;
+    std::map<const void *, uint32_t> meshIds;
+
+    template <class Vert>
+    static void bindModel(VkCommandBuffer commandBuffer, void *model) {
+        static_cast<Model<Vert> *>(model)->bind(commandBuffer);
+    }
+    Draw &add(uint32_t pass, Pipeline &pipeline, const std::vector<DescriptorSet *> &sets,
+              void *mesh, uint32_t count, float depth);
+};
+
+template <class Vert>
+RenderQueue::Draw &RenderQueue::submit(uint32_t pass, Pipeline &pipeline,
+                                       std::vector<DescriptorSet *> sets,
+                                       Model<Vert> &model, float depth) {
+    Draw &draw = add(pass, pipeline, sets, &model,
+                     static_cast<uint32_t>(model.indices.size()), depth);
+    draw.bindMesh = bindModel<Vert>;
+    return draw;
+}
+
+#endif//RENDER_QUEUE_HPP
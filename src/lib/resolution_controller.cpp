@@ -0,0 +1,26 @@
+#include <resolution_controller.hpp>
+#include <algorithm>
+#include <cmath>
+
+void ResolutionController::update(float frameTime) {
+    if(frameTime <= 0.0f) {
+        return;
+    }
+    samples.push_back({current, frameTime});
+    while(samples.size() > historySize) {
+        samples.pop_front();
+    }
+
+    // over the target is always corrected, the band is below it
+    float ratio = target / frameTime;
+    if(ratio < 1.0f || ratio > 1.0f / (1.0f - deadBand)) {
+        float wanted = current * std::sqrt(ratio);
+        current += gain * (wanted - current);
+    }
+    current = std::clamp(current, minScale, maxScale);
+}
+
+void ResolutionController::reset() {
+    current = maxScale;
+    samples.clear();
+}
@@ -0,0 +1,40 @@
+#ifndef RESOLUTION_CONTROLLER_HPP
+#define RESOLUTION_CONTROLLER_HPP
+
+#include <cstddef>
+#include <deque>
+
+// Scale of the render resolution which keeps the measured frame time close
+// to a target. The cost of a frame is taken as proportional to its pixels,
+// the square of the scale: each update moves the scale a fraction of the way
+// to the one which would have hit the target, unless the frame time is
+// already within the dead band below it.
+class ResolutionController {
+public:
+    struct Sample {
+        float scale;        // used by the frame
+        float frameTime;    // measured, in seconds
+    };
+
+    float target = 1.0f / 60.0f;
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    // fraction of the correction applied by an update
+    float gain = 0.2f;
+    // frame times down to this fraction below the target need no correction
+    float deadBand = 0.05f;
+    // samples kept in the history
+    size_t historySize = 240;
+
+    inline float scale() const { return current; }
+    // oldest first
+    inline const std::deque<Sample> &history() const { return samples; }
+    void update(float frameTime);
+    void reset();
+
+private:
+    float current = 1.0f;
+    std::deque<Sample> samples;
+};
+
+#endif//RESOLUTION_CONTROLLER_HPP
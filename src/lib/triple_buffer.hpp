@@ -0,0 +1,50 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+// Lock free single producer / single consumer channel keeping only the
+// latest value. The writer fills writeBuffer() and publishes it, the reader
+// calls update() and then looks at read(): neither of them ever waits, the
+// reader just skips the values published in the meantime.
+// Three slots: one owned by the writer, one by the reader and one in the
+// middle, exchanged atomically with the other two.
+template <class T>
+class TripleBuffer {
+    static const uint8_t INDEX = 0x3;
+    // set on the middle slot when it holds a value the reader has not seen
+    static const uint8_t FRESH = 0x4;
+
+    // each slot on its own cache line, writer and reader never share one
+    struct alignas(64) Slot {
+        T value;
+    };
+    Slot slots[3];
+    std::atomic<uint8_t> middle{1};
+    uint8_t back = 0;   // owned by the writer
+    uint8_t front = 2;  // owned by the reader
+public:
+    // Writer side
+    T& writeBuffer() {
+        return slots[back].value;
+    }
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader side, returns true if a new value has been published since
+    // the last call
+    bool update() {
+        if(!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& read() const {
+        return slots[front].value;
+    }
+};
+
+#endif//TRIPLE_BUFFER_HPP
@@ -0,0 +1,118 @@
+#include <work_stealing_pool.hpp>
+#include <algorithm>
+
+thread_local int WorkStealingPool::workerId = -1;
+
+WorkStealingPool::WorkStealingPool(size_t threads) {
+    if(threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for(size_t i = 0; i < threads; i++) {
+        queues.emplace_back(new Queue());
+    }
+    for(size_t i = 0; i < threads; i++) {
+        workers.emplace_back(&WorkStealingPool::work, this, (int)i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskReady.notify_all();
+    for(auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    size_t q = workerId >= 0 ? (size_t)workerId :
+        nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    // counted before the push, the task may complete right after it
+    pending++;
+    {
+        std::lock_guard<std::mutex> lock(queues[q]->mutex);
+        queues[q]->tasks.push_back(std::move(task));
+    }
+    // counted after the push, so a worker seeing it finds the task
+    queued++;
+    // a worker counted in sleeping after this check sees queued, one
+    // between its check of queued and its sleep holds the lock
+    if(sleeping > 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        taskReady.notify_one();
+    }
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    tasksDone.wait(lock, [this]{ return pending == 0; });
+    if(error) {
+        std::exception_ptr e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+int WorkStealingPool::currentWorker() {
+    return workerId;
+}
+
+bool WorkStealingPool::take(int id, std::function<void()> &task) {
+    // newest of the own queue, still hot in the cache
+    {
+        Queue &own = *queues[id];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+    // oldest of the others, the farthest from what their owners work on
+    for(size_t i = 1; i < queues.size(); i++) {
+        Queue &other = *queues[(id + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if(!other.tasks.empty()) {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            queued--;
+            stolen++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::work(int id) {
+    workerId = id;
+    while(true) {
+        std::function<void()> task;
+        if(!take(id, task)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping++;
+            taskReady.wait(lock, [this]{ return stopping || queued > 0; });
+            sleeping--;
+            if(stopping && queued == 0) {
+                return;
+            }
+            continue;
+        }
+
+        try {
+            task();
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(!error) {
+                error = std::current_exception();
+            }
+        }
+
+        if(--pending == 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasksDone.notify_all();
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker threads with a task queue each: a worker runs the newest task of
+// its own queue and, when that is empty, steals the oldest task of another
+// one. Submitting and completing a task only lock the queue it goes to,
+// the pool lock is taken to sleep and to wake sleeping threads. wait()
+// blocks until every task submitted so far has completed.
+class WorkStealingPool {
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    // guards stopping and error, and the sleeps on the condition variables
+    std::mutex mutex;
+    std::condition_variable taskReady, tasksDone;
+    // tasks in the queues, and tasks not completed yet
+    std::atomic<size_t> queued{0}, pending{0};
+    // workers waiting for taskReady, they are notified only if any
+    std::atomic<size_t> sleeping{0};
+    std::atomic<size_t> nextQueue{0};
+    bool stopping = false;
+    std::atomic<size_t> stolen{0};
+    // first exception thrown by a task, rethrown by wait()
+    std::exception_ptr error;
+
+    static thread_local int workerId;
+    bool take(int id, std::function<void()> &task);
+    void work(int id);
+public:
+    // 0 threads means one for each hardware thread
+    WorkStealingPool(size_t threads = 0);
+    ~WorkStealingPool();
+    // from a worker the task goes to its own queue, otherwise the queues
+    // are filled in turn
+    void submit(std::function<void()> task);
+    void wait();
+    inline size_t size() const { return workers.size(); }
+    // tasks run by a worker other than the one they were queued to
+    inline size_t steals() const { return stolen; }
+    // index of the worker running the caller, -1 outside the pool
+    static int currentWorker();
+};
+
+#endif//WORK_STEALING_POOL_HPP
@@ -1,20 +1,166 @@
 #include "game/game_main.hpp"
+#include <cstring>
 #include <exception>
+#include <stdexcept>
+#include <string>
 #include <log.h>
 
-int main() {
+// Without options the hand made race is played, any of
+//      --seed <n> --asteroids <n> --crystals <n> --checkpoints <n>
+// plays on a procedural field instead.
+//      --tick-rate <n> sets the simulation steps per second
+//      --sim-thread 0 runs the simulation on the render thread
+//      --gpu-culling 1 culls the asteroid field with a compute shader
+//      --occlusion-culling 1   also skips the asteroids hidden by the sun and
+//                      the Earth, implies --gpu-culling
+//      --culling-stats 1   reads back and logs the asteroids drawn by the
+//                      GPU culling
+//      --draw-order 0  draws in a fixed order with the universe first,
+//                      instead of front to back with the universe last
+//      --fragment-stats 1  logs the fragment shader invocations of a frame
+//      --low-quality 1 shades without specular highlights and normal maps
+//      --dynamic-resolution <ms>   scales the resolution of the scene to
+//                      draw it in this GPU time, the HUD stays native
+//      --record <file> saves the input of every frame
+//      --replay <file> plays a recorded input instead of the controllers,
+//                      on the render thread so that the ticks are the same
+//      --fixed-dt <s>  replays with this frame time instead of the recorded one
+//      --headless <n>  renders n frames offscreen, without window, with a
+//                      frame time of --fixed-dt (1/60 s by default)
+//      --capture <n>   saves the frame n of a headless run to a PNG, can
+//                      be repeated
+//      --capture-prefix <path>  file name of the PNGs before the frame
+//                      number (default frame)
+//      --benchmark <n> flies the camera along a fixed path for n frames,
+//                      windowed or with --headless, then reports the CPU,
+//                      fence wait and GPU times of the frames
+//      --benchmark-csv <file>  also writes the times of every frame
+static bool parseArgs(int argc, char **argv, GameMain &app) {
+    for(int i = 1; i < argc; i++) {
+        if(i + 1 >= argc) {
+            logError("Missing value for %s", argv[i]);
+            return false;
+        }
+        try {
+            if(!strcmp(argv[i], "--seed")) {
+                app.field.seed = std::stoul(argv[++i]);
+                app.proceduralField = true;
+            } else if(!strcmp(argv[i], "--asteroids")) {
+                app.field.asteroids = std::stoi(argv[++i]);
+                app.proceduralField = true;
+            } else if(!strcmp(argv[i], "--crystals")) {
+                app.field.powerUps = std::stoi(argv[++i]);
+                app.proceduralField = true;
+            } else if(!strcmp(argv[i], "--checkpoints")) {
+                app.field.checkpoints = std::stoi(argv[++i]);
+                app.proceduralField = true;
+            } else if(!strcmp(argv[i], "--sim-thread")) {
+                app.simulationThread = std::stoi(argv[++i]) != 0;
+            } else if(!strcmp(argv[i], "--gpu-culling")) {
+                app.gpuCulling = std::stoi(argv[++i]) != 0;
+            } else if(!strcmp(argv[i], "--occlusion-culling")) {
+                app.occlusionCulling = std::stoi(argv[++i]) != 0;
+            } else if(!strcmp(argv[i], "--culling-stats")) {
+                app.cullingStatistics = std::stoi(argv[++i]) != 0;
+            } else if(!strcmp(argv[i], "--draw-order")) {
+                app.frontToBack = std::stoi(argv[++i]) != 0;
+            } else if(!strcmp(argv[i], "--low-quality")) {
+                app.lowQualityShading = std::stoi(argv[++i]) != 0;
+            } else if(!strcmp(argv[i], "--fragment-stats")) {
+                app.fragmentStatistics = std::stoi(argv[++i]) != 0;
+            } else if(!strcmp(argv[i], "--dynamic-resolution")) {
+                float target = std::stof(argv[++i]);
+                if(target <= 0.0f) {
+                    throw std::invalid_argument("dynamic resolution");
+                }
+                app.dynamicResolution = true;
+                app.resolution.target = target / 1000.0f;
+            } else if(!strcmp(argv[i], "--tick-rate")) {
+                app.tickRate = std::stof(argv[++i]);
+                if(app.tickRate <= 0.0f) {
+                    throw std::invalid_argument("tick rate");
+                }
+            } else if(!strcmp(argv[i], "--record")) {
+                app.recordInputFile = argv[++i];
+            } else if(!strcmp(argv[i], "--replay")) {
+                app.replayInputFile = argv[++i];
+            } else if(!strcmp(argv[i], "--headless")) {
+                app.headlessFrames = std::stoull(argv[++i]);
+                app.headless = true;
+            } else if(!strcmp(argv[i], "--capture")) {
+                app.captureFrames.insert(std::stoull(argv[++i]));
+            } else if(!strcmp(argv[i], "--capture-prefix")) {
+                app.capturePrefix = argv[++i];
+            } else if(!strcmp(argv[i], "--benchmark")) {
+                app.benchmarkFrames = std::stoull(argv[++i]);
+                if(app.benchmarkFrames == 0) {
+                    throw std::invalid_argument("benchmark");
+                }
+            } else if(!strcmp(argv[i], "--benchmark-csv")) {
+                app.benchmarkCsv = argv[++i];
+            } else if(!strcmp(argv[i], "--fixed-dt")) {
+                app.replayDeltaT = std::stof(argv[++i]);
+                if(app.replayDeltaT <= 0.0f) {
+                    throw std::invalid_argument("fixed dt");
+                }
+            } else {
+                logError("Unknown option %s", argv[i]);
+                return false;
+            }
+        } catch (const std::exception& e) {
+            logError("Invalid value for %s", argv[i - 1]);
+            return false;
+        }
+    }
+    if(app.occlusionCulling) {
+        // the occlusion test runs in the culling shader
+        app.gpuCulling = true;
+    }
+    if(!app.captureFrames.empty() && !app.headless) {
+        logError("--capture needs --headless");
+        return false;
+    }
+    if(app.headless) {
+        // the frames must not depend on the scheduling either
+        app.simulationThread = false;
+    }
+    if(app.benchmarkFrames) {
+        app.recordFrameStats = true;
+        app.gpuTiming = true;
+        if(app.headless) {
+            app.headlessFrames = app.benchmarkFrames;
+        }
+    }
+    if(!app.replayInputFile.empty()) {
+        // the ticks run by the simulation thread depend on the scheduling
+        app.simulationThread = false;
+        if(!app.recordInputFile.empty()) {
+            logError("--record and --replay can not be used together");
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
     // Set loglevel for the debugger
     logSetLevel(LOG_LEVEL_DEBUG);
 
     GameMain app;
+    if(!parseArgs(argc, argv, app)) {
+        return EXIT_FAILURE;
+    }
     logInfo("Starting vulkan project");
 
     try {
         app.run();
+        if(app.benchmarkFrames) {
+            app.reportBenchmark();
+        }
     } catch (const std::exception& e) {
-        logError(e.what());
+        logError("%s", e.what());
         return EXIT_FAILURE;
     }
     logInfo("Execution success");
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}